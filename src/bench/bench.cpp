@@ -0,0 +1,262 @@
+// Benchmarks for the solvers and the hot parts of the domain model.
+//
+// Usage: baryon_bench [max_zps [dfbb_max_zps [ida_max_zps]]]
+//
+// Every result is printed to stdout as one JSON object per line.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "solvers/astar.hpp"
+#include "solvers/dfbb.hpp"
+#include "solvers/ida.hpp"
+#include "solvers/replanner.hpp"
+#include "problems/buildorder.hpp"
+#include "definitions/types.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//! Reset the peak RSS of this process, where the kernel supports it.
+void reset_peak_rss()
+{
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+}
+
+//! Peak RSS in kB since the last reset_peak_rss(), or 0 if unknown.
+long peak_rss_kb()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line))
+    {
+        if(line.compare(0, 6, "VmHWM:") == 0)
+        {
+            return std::atol(line.c_str() + 6);
+        }
+    }
+    return 0;
+}
+
+struct SearchCounters
+{
+    std::size_t expanded = 0;
+    std::size_t generated = 0;
+    std::size_t heuristic_calls = 0;
+};
+
+//! Problem wrapper that counts the work a solver asks for, so that every
+//! solver can be measured the same way.
+template<typename Problem>
+class CountingProblem
+{
+public:
+    CountingProblem(Problem problem_, SearchCounters* counters_)
+        : problem(problem_)
+        , counters(counters_)
+    {
+    }
+
+    Node start_node() { return problem.start_node(); }
+    Time upper_bound() { return problem.upper_bound(); }
+    bool is_goal(const Node& n) { return problem.is_goal(n); }
+
+    Time heuristic(const Node& n)
+    {
+        ++counters->heuristic_calls;
+        return problem.heuristic(n);
+    }
+
+    template<typename T>
+    void visit_neighbors(const Node& n, T visitor)
+    {
+        ++counters->expanded;
+        problem.visit_neighbors(n, [this, &visitor](Node&& succ) {
+            ++counters->generated;
+            visitor(std::move(succ));
+        });
+    }
+
+private:
+    Problem problem;
+    SearchCounters* counters;
+};
+
+template<template<typename> class Solver>
+void bench_solver(const char* name, unsigned num_zps)
+{
+    SearchCounters counters;
+    Solver<CountingProblem<BuildOrderProblem>> solver(CountingProblem<BuildOrderProblem>(BuildOrderProblem(num_zps), &counters));
+    BuildOrder solution;
+
+    reset_peak_rss();
+    Clock::time_point start = Clock::now();
+    bool solved = solver.solve(solution);
+    double wall = seconds_since(start);
+
+    std::cout << "{\"bench\": \"solver\", \"solver\": \"" << name << "\""
+              << ", \"num_zps\": " << num_zps
+              << ", \"solved\": " << (solved ? "true" : "false")
+              << ", \"makespan\": " << (solved ? solution.back().t : -1)
+              << ", \"wall_s\": " << wall
+              << ", \"expanded\": " << counters.expanded
+              << ", \"generated\": " << counters.generated
+              << ", \"heuristic_calls\": " << counters.heuristic_calls
+              << ", \"nodes_per_s\": " << (wall > 0 ? counters.expanded / wall : 0)
+              << ", \"peak_rss_kb\": " << peak_rss_kb()
+              << "}" << std::endl;
+}
+
+void print_replan(const SolverOptions& options, const char* from, unsigned num_zps, std::size_t step, const char* how, const SolveResult& r)
+{
+    std::cout << "{\"bench\": \"replan\", \"solver\": \"" << solver_name(options.kind) << "\""
+              << ", \"from\": \"" << from << "\""
+              << ", \"num_zps\": " << num_zps
+              << ", \"step\": " << step
+              << ", \"how\": \"" << how << "\""
+              << ", \"makespan\": " << (r.solved ? r.plan.back().t : -1)
+              << ", \"reused\": " << (r.reused ? "true" : "false")
+              << ", \"wall_s\": " << r.seconds
+              << ", \"expanded\": " << r.stats.expanded
+              << "}" << std::endl;
+}
+
+//! Replan from States along the optimal plan, and from States that missed
+//! its next action, after solving from the start; the latter are also solved from
+//! scratch for comparison.
+void bench_replan(SolverKind kind, unsigned num_zps)
+{
+    SolverOptions options;
+    options.kind = kind;
+    Replanner replanner(num_zps, options);
+    BuildOrderProblem problem(num_zps);
+    SolveResult first = replanner.replan(problem.start_node().state, 0);
+    print_replan(options, "start", num_zps, 0, "replan", first);
+    if(!first.solved)
+        return;
+
+    BuildOrder plan = first.plan;
+    for(std::size_t step = plan.size() / 4; step + 1 < plan.size(); step += plan.size() / 4)
+    {
+        print_replan(options, "on_plan", num_zps, step, "replan", replanner.replan(plan[step].state, plan[step].t));
+
+        // The game missed the next action of the plan by a few ticks.
+        Node off = plan[step];
+        update(off, plan[step + 1].t - plan[step].t + 7);
+
+        ProblemSpecification spec;
+        spec.constants = game;
+        spec.start = off.state;
+        spec.start_time = off.t;
+        spec.goal_zps = num_zps;
+        print_replan(options, "off_plan", num_zps, step, "scratch", solve_specification(spec, options, std::make_shared<GatherCache>(), 0, nullptr));
+        print_replan(options, "off_plan", num_zps, step, "replan", replanner.replan(off.state, off.t));
+    }
+}
+
+//! Nodes reachable from the start in up to depth actions.
+std::vector<Node> sample_nodes(unsigned depth)
+{
+    BuildOrderProblem problem;
+    std::vector<Node> layer = {problem.start_node()};
+    std::vector<Node> all = layer;
+    for(unsigned d = 0; d < depth; ++d)
+    {
+        std::vector<Node> next;
+        for(const Node& n : layer)
+        {
+            problem.visit_neighbors(n, [&next](Node&& succ) {
+                succ.predecessor = nullptr;
+                next.push_back(succ);
+            });
+        }
+        all.insert(all.end(), next.begin(), next.end());
+        layer.swap(next);
+    }
+    return all;
+}
+
+//! Run op over the sample until at least min_ops operations were timed.
+void bench_micro(const char* name, const std::vector<Node>& sample, std::function<std::size_t(const Node&)> op)
+{
+    const std::size_t min_ops = 200000;
+    std::size_t ops = 0, sink = 0;
+    Clock::time_point start = Clock::now();
+    while(ops < min_ops)
+    {
+        for(const Node& n : sample)
+        {
+            sink += op(n);
+            ++ops;
+        }
+    }
+    double wall = seconds_since(start);
+
+    std::cout << "{\"bench\": \"" << name << "\""
+              << ", \"ops\": " << ops
+              << ", \"ns_per_op\": " << wall * 1e9 / ops
+              << ", \"checksum\": " << sink
+              << "}" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned max_zps = argc > 1 ? std::atoi(argv[1]) : 2;
+    unsigned dfbb_max_zps = argc > 2 ? std::atoi(argv[2]) : 2;
+    unsigned ida_max_zps = argc > 3 ? std::atoi(argv[3]) : 2;
+
+    std::vector<Node> sample = sample_nodes(3);
+    BuildOrderProblem problem;
+
+    bench_micro("update", sample, [](const Node& n) {
+        Node copy = n;
+        update(copy, game.lc_cycle_length / 2);
+        return std::size_t(copy.state.lc);
+    });
+    bench_micro("min_time_to_gather_lc", sample, [](const Node& n) {
+        return std::size_t(min_time_to_gather_lc(n, n.state.lc + 200));
+    });
+    bench_micro("visit_neighbors", sample, [&problem](const Node& n) {
+        std::size_t count = 0;
+        problem.visit_neighbors(n, [&count](Node&& succ) { count += succ.t; });
+        return count;
+    });
+    bench_micro("state_hash", sample, [](const Node& n) {
+        return std::hash<State>()(n.state);
+    });
+    bench_micro("state_equal", sample, [&sample](const Node& n) {
+        return std::size_t(n.state == sample.front().state);
+    });
+
+    for(unsigned k = 1; k <= max_zps; ++k)
+    {
+        bench_solver<AStarSolver>("astar", k);
+    }
+    for(unsigned k = 1; k <= dfbb_max_zps; ++k)
+    {
+        bench_solver<DFBBSolver>("dfbb", k);
+    }
+    for(unsigned k = 1; k <= ida_max_zps; ++k)
+    {
+        bench_solver<IDASolver>("ida", k);
+    }
+    for(unsigned k = 1; k <= max_zps; ++k)
+    {
+        bench_replan(SolverKind::ASTAR, k);
+    }
+    for(unsigned k = 1; k <= dfbb_max_zps; ++k)
+    {
+        bench_replan(SolverKind::DFBB, k);
+    }
+    return 0;
+}
@@ -3,46 +3,111 @@
 
 #include <cassert>
 #include <functional>
+#include <limits>
 
 #include "state.hpp"
 
+//! Add a timer to one of the containers of a State, keeping it sorted from
+//! most to least advanced.
+template<std::size_t N>
+void insert_timer(FixedVector<Timer, N>& timers, const Timer t)
+{
+    timers.insert(std::upper_bound(timers.begin(), timers.end(), t, std::greater<Timer>()), t);
+}
+
+template<std::size_t N>
+void sort_timers(FixedVector<Timer, N>& timers)
+{
+    std::sort(timers.begin(), timers.end(), std::greater<Timer>());
+}
+
+template<std::size_t N>
+bool timers_sorted(const FixedVector<Timer, N>& timers)
+{
+    return std::is_sorted(timers.begin(), timers.end(), std::greater<Timer>());
+}
+
+//! Bring a State built by other means than the actions into the canonical
+//! order of its timer containers.
+void canonicalize(State& s)
+{
+    sort_timers(s.lc_rp_state);
+    sort_timers(s.qp_rp_state);
+    sort_timers(s.foundation_queue);
+    sort_timers(s.depot_queue);
+    sort_timers(s.zv_queue);
+    sort_timers(s.zp_queue);
+    sort_timers(s.zp_upgrade_queue);
+}
+
+bool is_canonical(const State& s)
+{
+    return timers_sorted(s.lc_rp_state) &&
+           timers_sorted(s.qp_rp_state) &&
+           timers_sorted(s.foundation_queue) &&
+           timers_sorted(s.depot_queue) &&
+           timers_sorted(s.zv_queue) &&
+           timers_sorted(s.zp_queue) &&
+           timers_sorted(s.zp_upgrade_queue);
+}
+
 Resource update_rps(const Time dt, RPState& rp_state, const Time cycle_length,
                     const Resource yield_size)
 {
     Resource res = 0;
-    for(Time& t : rp_state)
+    for(Timer& timer : rp_state)
     {
-        t += dt;
+        Time t = timer + dt;
         if(t >= 0)
         {
             res += (t / cycle_length) * yield_size;
             t %= cycle_length;
         }
+        timer = t;
+    }
+    if(res > 0)
+    {
+        // RPs that yielded went back to the start of their cycle.
+        sort_timers(rp_state);
     }
     return res;
 }
 
-unsigned update_production(const Time dt, ProductionState& queue)
+template<std::size_t N>
+unsigned update_production(const Time dt, ProductionState<N>& queue)
 {
-    for(Time& t : queue)
+    if(queue.empty())
+        return 0;
+
+    // Advance in Time and compact in place; finished entries may not fit in a
+    // Timer anymore. They are the most advanced, so the order is kept.
+    auto out = queue.begin();
+    for(Timer timer : queue)
     {
-        t += dt;
+        Time t = timer + dt;
+        if(t < 0)
+        {
+            *out++ = t;
+        }
     }
-
-    using namespace std::placeholders;
-    auto iter = std::remove_if(queue.begin(), queue.end(),
-                               std::bind(std::greater_equal<Time>(), _1, 0));
-    unsigned n = queue.end() - iter;
-    queue.erase(iter, queue.end());
+    unsigned n = queue.end() - out;
+    queue.erase(out, queue.end());
     return n;
 }
 
+//! Advance every timer of state by dt and collect what completes. Timers
+//! are relative to the State's time, so all of them move. That is at most
+//! MAX_RPS twice plus the queue limits, six on average in a search, all
+//! within the two cache lines the State takes. An event calendar would
+//! skip the walk, but States must hash and compare equal whatever their
+//! time, and the heuristic and the waits read the timers directly, so its
+//! absolute times would have to be rebased at each of those instead.
 void update(State& state, const Time dt)
 {
     assert(dt > 0);
 
-    state.lc += update_rps(dt, state.lc_rp_state, LC_CYCLE_LENGTH, LC_YIELD_SIZE);
-    state.qp += update_rps(dt, state.qp_rp_state, QP_CYCLE_LENGTH, QP_YIELD_SIZE);
+    state.lc += update_rps(dt, state.lc_rp_state, game.lc_cycle_length, game.lc_yield_size);
+    state.qp += update_rps(dt, state.qp_rp_state, game.qp_cycle_length, game.qp_yield_size);
 
     state.foundations += update_production(dt, state.foundation_queue);
     state.depots += update_production(dt, state.depot_queue);
@@ -59,30 +124,133 @@ void update(Node& n, const Time dt)
     n.t += dt;
 }
 
-Time time_to_next_produced(const ProductionState& v)
+template<std::size_t N>
+Time time_to_next_produced(const ProductionState<N>& v)
+{
+    return -v.front();
+}
+
+// Events
+
+//! Kinds of events that change a State. Resources and unit counts only
+//! change when one of these happens.
+enum EventSource : unsigned
+{
+    LC_YIELD = 1 << 0,
+    QP_YIELD = 1 << 1,
+    FOUNDATION_DONE = 1 << 2,
+    DEPOT_DONE = 1 << 3,
+    ZV_DONE = 1 << 4,
+    ZP_DONE = 1 << 5,
+    ZP_UPGRADE_DONE = 1 << 6
+};
+
+constexpr Time NEVER = std::numeric_limits<Time>::max();
+
+Time time_to_next_yield(const RPState& rps, const Time cycle_length)
+{
+    if(rps.empty())
+        return NEVER;
+
+    return cycle_length - rps.front();
+}
+
+template<std::size_t N>
+Time time_to_next_completion(const ProductionState<N>& queue)
 {
-    return -(*std::max_element(v.begin(), v.end()));
+    return queue.empty() ? NEVER : time_to_next_produced(queue);
+}
+
+//! Return the time until the next event of one of the given sources, or
+//! NEVER if none is pending.
+Time time_to_next_event(const State& s, const unsigned sources)
+{
+    Time dt = NEVER;
+    if(sources & LC_YIELD)
+        dt = std::min(dt, time_to_next_yield(s.lc_rp_state, game.lc_cycle_length));
+    if(sources & QP_YIELD)
+        dt = std::min(dt, time_to_next_yield(s.qp_rp_state, game.qp_cycle_length));
+    if(sources & FOUNDATION_DONE)
+        dt = std::min(dt, time_to_next_completion(s.foundation_queue));
+    if(sources & DEPOT_DONE)
+        dt = std::min(dt, time_to_next_completion(s.depot_queue));
+    if(sources & ZV_DONE)
+        dt = std::min(dt, time_to_next_completion(s.zv_queue));
+    if(sources & ZP_DONE)
+        dt = std::min(dt, time_to_next_completion(s.zp_queue));
+    if(sources & ZP_UPGRADE_DONE)
+        dt = std::min(dt, time_to_next_completion(s.zp_upgrade_queue));
+    return dt;
+}
+
+//! Advance n from event to event until pred holds. Only events of the given
+//! sources are visited, so they must be the only ones pred depends on.
+template<typename Predicate>
+void advance_until(Node& n, const unsigned sources, Predicate pred)
+{
+    while(!pred(n.state))
+    {
+        Time dt = time_to_next_event(n.state, sources);
+        assert(dt != NEVER && "waiting for an event that never happens");
+        update(n, dt);
+    }
 }
 
 // Resources
 
-void spend_resource(Node& state, Resource& res, const Resource target, const Resource yield_size, const Time cycle_length, const RPState& rps)
+//! Return how many yields the RPs in rps complete within dt ticks.
+unsigned yields_within(const Time dt, const RPState& rps, const Time cycle_length)
 {
-    if(res < target)
+    unsigned yields = 0;
+    for(Timer t : rps)
     {
-        Time dt = 0;
-        int full_cycles = ((target - res) / yield_size) / rps.size();
-        dt += full_cycles * cycle_length;
-        if(dt > 0)
+        if(t + dt >= cycle_length)
         {
-            update(state, dt);
+            yields += (t + dt) / cycle_length;
         }
+    }
+    return yields;
+}
+
+//! Return the time until the RPs in rps have yielded enough to bring res up
+//! to target.
+Time time_to_resource(const Resource res, const Resource target, const RPState& rps,
+                      const Time cycle_length, const Resource yield_size)
+{
+    if(res >= target)
+        return 0;
+
+    assert(!rps.empty());
+    unsigned yields = (target - res + yield_size - 1) / yield_size;
 
-        while(res < target)
+    // The merged yield schedule of all RPs is monotone in time, so search
+    // it for the first tick by which enough yields have happened. The RP
+    // closest to its first yield gets there on its own by hi.
+    Time first = cycle_length - rps.front();
+    Time lo = first, hi = first + (yields - 1) * cycle_length;
+    while(lo < hi)
+    {
+        Time mid = lo + (hi - lo) / 2;
+        if(yields_within(mid, rps, cycle_length) >= yields)
         {
-            update(state, 1);
+            hi = mid;
         }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void spend_resource(Node& state, Resource& res, const Resource target, const Resource yield_size, const Time cycle_length, const RPState& rps)
+{
+    Time dt = time_to_resource(res, target, rps, cycle_length, yield_size);
+    if(dt > 0)
+    {
+        update(state, dt);
     }
+    assert(res >= target);
     res -= target;
 }
 
@@ -93,7 +261,7 @@ bool can_spend_lc(const Node& n, Resource lc)
 
 void spend_lc(Node& n, const Resource lc)
 {
-    spend_resource(n, n.state.lc, lc, LC_YIELD_SIZE, LC_CYCLE_LENGTH, n.state.lc_rp_state);
+    spend_resource(n, n.state.lc, lc, game.lc_yield_size, game.lc_cycle_length, n.state.lc_rp_state);
 }
 
 bool can_spend_qp(const Node& n, Resource qp)
@@ -103,7 +271,7 @@ bool can_spend_qp(const Node& n, Resource qp)
 
 void spend_qp(Node& n, const Resource qp)
 {
-    spend_resource(n, n.state.qp, qp, QP_YIELD_SIZE, QP_CYCLE_LENGTH, n.state.qp_rp_state);
+    spend_resource(n, n.state.qp, qp, game.qp_yield_size, game.qp_cycle_length, n.state.qp_rp_state);
 }
 
 // Buildings
@@ -117,28 +285,30 @@ bool has_zv(const Node& n)
 
 void wait_for_zv(Node& n)
 {
-    if(n.state.zvs < 1)
-    {
-        assert(!n.state.zv_queue.empty());
-        update(n, time_to_next_produced(n.state.zv_queue));
-    }
+    advance_until(n, ZV_DONE, [](const State& s) { return s.zvs >= 1; });
+}
+
+bool has_rp_slot(const Node& n)
+{
+    return n.state.lc_rp_state.size() + n.state.qp_rp_state.size() < MAX_RPS;
 }
 
 bool can_build_lc_rp(const Node& n)
 {
     return has_zv(n) &&
-           can_spend_lc(n, RP_LC_COST);
+           has_rp_slot(n) &&
+           can_spend_lc(n, game.rp_lc_cost);
 }
 
 Node build_lc_rp(const Node& n)
 {
     Node result = n;
-    result.action.description = "Build an LC RP.";
+    result.action = {BUILD_LC_RP, "Build an LC RP."};
     result.predecessor = &n;
 
     wait_for_zv(result);
-    spend_lc(result, RP_LC_COST);
-    result.state.lc_rp_state.push_back(-RP_BUILD_TIME);
+    spend_lc(result, game.rp_lc_cost);
+    insert_timer(result.state.lc_rp_state, -game.rp_build_time);
 
     return result;
 }
@@ -148,44 +318,33 @@ TRY(build_lc_rp);
 bool can_build_qp_rp(const Node& n)
 {
     return has_zv(n) &&
-           can_spend_lc(n, RP_LC_COST);
+           has_rp_slot(n) &&
+           can_spend_lc(n, game.rp_lc_cost);
 }
 
 Node build_qp_rp(const Node& n)
 {
     Node result = n;
-    result.action.description = "Build a QP RP.";
+    result.action = {BUILD_QP_RP, "Build a QP RP."};
     result.predecessor = &n;
 
     wait_for_zv(result);
-    spend_lc(result, RP_LC_COST);
-    result.state.qp_rp_state.push_back(-RP_BUILD_TIME);
+    spend_lc(result, game.rp_lc_cost);
+    insert_timer(result.state.qp_rp_state, -game.rp_build_time);
 
     return result;
 }
 
 TRY(build_qp_rp);
 
-Time time_to_cycle_switch(const Time t, const Time cycle_length)
-{
-    if(t >= 0)
-    {
-        return cycle_length - t;
-    }
-    else
-    {
-        // Not done building, but also needs to complete at least one cycle
-        // to justify.
-        return -t + cycle_length;
-    }
-}
-
 RPState::iterator wait_for_idle_rp(Node& n, RPState& rps, const Time cycle_length)
 {
-    auto iter = std::min_element(rps.begin(), rps.end(), [cycle_length](Time a, Time b) {
-        return time_to_cycle_switch(a, cycle_length) < time_to_cycle_switch(b, cycle_length);
-    });
-    update(n, time_to_cycle_switch(*iter, cycle_length));
+    // The RP whose next yield comes first, which is the front one. One that
+    // is still being built must also complete a cycle, to justify building
+    // it. After the yield its timer is 0, and any RP at 0 will do.
+    update(n, time_to_next_yield(rps, cycle_length));
+    auto iter = std::find(rps.begin(), rps.end(), Timer(0));
+    assert(iter != rps.end());
     return iter;
 }
 
@@ -197,11 +356,11 @@ bool can_switch_lc_to_qp(const Node& n)
 Node switch_lc_to_qp(const Node& n)
 {
     Node result = n;
-    result.action.description = "Switch an LC RP to QP.";
+    result.action = {SWITCH_LC_TO_QP, "Switch an LC RP to QP."};
     result.predecessor = &n;
 
-    result.state.lc_rp_state.erase(wait_for_idle_rp(result, result.state.lc_rp_state, LC_CYCLE_LENGTH));
-    result.state.qp_rp_state.push_back(-RP_SWITCH_TIME);
+    result.state.lc_rp_state.erase(wait_for_idle_rp(result, result.state.lc_rp_state, game.lc_cycle_length));
+    insert_timer(result.state.qp_rp_state, -game.rp_switch_time);
 
     return result;
 }
@@ -216,11 +375,11 @@ bool can_switch_qp_to_lc(const Node& n)
 Node switch_qp_to_lc(const Node& n)
 {
     Node result = n;
-    result.action.description = "Switch a QP RP to LC.";
+    result.action = {SWITCH_QP_TO_LC, "Switch a QP RP to LC."};
     result.predecessor = &n;
 
-    result.state.qp_rp_state.erase(wait_for_idle_rp(result, result.state.qp_rp_state, QP_CYCLE_LENGTH));
-    result.state.lc_rp_state.push_back(-RP_SWITCH_TIME);
+    result.state.qp_rp_state.erase(wait_for_idle_rp(result, result.state.qp_rp_state, game.qp_cycle_length));
+    insert_timer(result.state.lc_rp_state, -game.rp_switch_time);
 
     return result;
 }
@@ -229,26 +388,25 @@ TRY(switch_qp_to_lc);
 
 void wait_for_annex(Node& n)
 {
-    if(!n.state.zv_queue.empty())
-    {
-        update(n, time_to_next_produced(n.state.zv_queue));
-    }
+    advance_until(n, ZV_DONE, [](const State& s) { return s.zv_queue.size() < s.annexes; });
 }
 
 bool can_build_zv(const Node& n)
 {
-    return n.state.annexes >= 1 && can_spend_lc(n, ZV_LC_COST);
+    return n.state.annexes >= 1 &&
+           !n.state.zv_queue.full() &&
+           can_spend_lc(n, game.zv_lc_cost);
 }
 
 Node build_zv(const Node& n)
 {
     Node result = n;
-    result.action.description = "Build a ZV.";
+    result.action = {BUILD_ZV, "Build a ZV."};
     result.predecessor = &n;
 
     wait_for_annex(result);
-    spend_lc(result, ZV_LC_COST);
-    result.state.zv_queue.push_back(-ZV_BUILD_TIME);
+    spend_lc(result, game.zv_lc_cost);
+    insert_timer(result.state.zv_queue, -game.zv_build_time);
 
     return result;
 }
@@ -272,26 +430,12 @@ bool has_depot(const Node& n)
 
 void wait_for_depot(Node& n)
 {
-    if(has_ready_depot(n) && n.state.zp_queue.size() < PULSERS_PER_DEPOT * n.state.depots)
-        return;
-
-    // Wait for a new depot or until the next vehicle is done, whichever is faster.
-    Time dt = std::numeric_limits<Time>::max();
-
-    if(!n.state.depot_queue.empty())
-    {
-        dt = std::min(dt, time_to_next_produced(n.state.depot_queue));
-    }
-
     assert(n.state.zp_queue.size() <= PULSERS_PER_DEPOT * n.state.depots);
-    if(!n.state.zp_queue.empty() && n.state.zp_queue.size() == PULSERS_PER_DEPOT * n.state.depots)
-    {
-        dt = std::min(dt, time_to_next_produced(n.state.zp_queue));
-    }
 
-    assert(dt != std::numeric_limits<Time>::max());
-
-    update(n, dt);
+    // Wait for a new depot or until a vehicle is done, whichever is faster.
+    advance_until(n, DEPOT_DONE | ZP_DONE, [](const State& s) {
+        return s.depots >= 1 && s.zp_queue.size() < PULSERS_PER_DEPOT * s.depots;
+    });
 }
 
 void use_zv(Node& n)
@@ -302,23 +446,24 @@ void use_zv(Node& n)
 bool can_pilot_zp(const Node& n)
 {
     return has_depot(n) &&
+           !n.state.zp_queue.full() &&
            has_zv(n) &&
-           can_spend_lc(n, ZP_LC_COST) &&
-           can_spend_qp(n, ZP_QP_COST);
+           can_spend_lc(n, game.zp_lc_cost) &&
+           can_spend_qp(n, game.zp_qp_cost);
 }
 
 Node pilot_zp(const Node& n)
 {
     Node result = n;
-    result.action.description = "Pilot a ZP.";
+    result.action = {PILOT_ZP, "Pilot a ZP."};
     result.predecessor = &n;
 
     wait_for_zv(result);
     wait_for_depot(result);
     use_zv(result);
-    spend_lc(result, ZP_LC_COST);
-    spend_qp(result, ZP_QP_COST);
-    result.state.zp_queue.push_back(-ZP_PILOT_TIME);
+    spend_lc(result, game.zp_lc_cost);
+    spend_qp(result, game.zp_qp_cost);
+    insert_timer(result.state.zp_queue, -game.zp_pilot_time());
 
     return result;
 }
@@ -328,21 +473,22 @@ TRY(pilot_zp);
 bool can_build_zp(const Node& n)
 {
     return has_depot(n) &&
+           !n.state.zp_queue.full() &&
            n.state.annexes >= 1 &&
-           can_spend_lc(n, ZV_LC_COST + ZP_LC_COST) &&
-           can_spend_qp(n, ZP_QP_COST);
+           can_spend_lc(n, game.zv_lc_cost + game.zp_lc_cost) &&
+           can_spend_qp(n, game.zp_qp_cost);
 }
 
 Node build_zp(const Node& n)
 {
     Node result = n;
-    result.action.description = "Build a ZP.";
+    result.action = {BUILD_ZP, "Build a ZP."};
     result.predecessor = &n;
 
     wait_for_depot(result);
-    spend_lc(result, ZV_LC_COST + ZP_LC_COST);
-    spend_qp(result, ZP_QP_COST);
-    result.state.zp_queue.push_back(-ZP_BUILD_TIME);
+    spend_lc(result, game.zv_lc_cost + game.zp_lc_cost);
+    spend_qp(result, game.zp_qp_cost);
+    insert_timer(result.state.zp_queue, -game.zp_build_time);
 
     return result;
 }
@@ -356,11 +502,7 @@ bool has_zp(const Node& n)
 
 void wait_for_zp(Node& n)
 {
-    if(n.state.zps < 1)
-    {
-        assert(!n.state.zp_queue.empty());
-        update(n, time_to_next_produced(n.state.zp_queue));
-    }
+    advance_until(n, ZP_DONE, [](const State& s) { return s.zps >= 1; });
 }
 
 void use_zp(Node& n)
@@ -371,21 +513,22 @@ void use_zp(Node& n)
 bool can_upgrade_zp(const Node& n)
 {
     return has_zp(n) &&
-           can_spend_lc(n, SKIP_UPGRADE_LC_COST) &&
-           can_spend_qp(n, SKIP_UPGRADE_QP_COST);
+           !n.state.zp_upgrade_queue.full() &&
+           can_spend_lc(n, game.skip_upgrade_lc_cost) &&
+           can_spend_qp(n, game.skip_upgrade_qp_cost);
 }
 
 Node upgrade_zp(const Node& n)
 {
     Node result = n;
-    result.action.description = "Upgrade a ZP.";
+    result.action = {UPGRADE_ZP, "Upgrade a ZP."};
     result.predecessor = &n;
 
     wait_for_zp(result);
     use_zp(result);
-    spend_lc(result, SKIP_UPGRADE_LC_COST);
-    spend_qp(result, SKIP_UPGRADE_QP_COST);
-    result.state.zp_upgrade_queue.push_back(-SKIP_UPGRADE_TIME);
+    spend_lc(result, game.skip_upgrade_lc_cost);
+    spend_qp(result, game.skip_upgrade_qp_cost);
+    insert_timer(result.state.zp_upgrade_queue, -game.skip_upgrade_time);
 
     return result;
 }
@@ -399,11 +542,7 @@ bool has_foundation(const Node& n)
 
 void wait_for_foundation(Node& n)
 {
-    if(n.state.foundations < 1)
-    {
-        assert(!n.state.foundation_queue.empty());
-        update(n, time_to_next_produced(n.state.foundation_queue));
-    }
+    advance_until(n, FOUNDATION_DONE, [](const State& s) { return s.foundations >= 1; });
 }
 
 void use_foundation(Node& n)
@@ -414,21 +553,22 @@ void use_foundation(Node& n)
 bool can_build_depot(const Node& n)
 {
     return has_foundation(n) &&
-           can_spend_lc(n, DEPOT_LC_COST) &&
-           can_spend_qp(n, DEPOT_QP_COST);
+           !n.state.depot_queue.full() &&
+           can_spend_lc(n, game.depot_lc_cost) &&
+           can_spend_qp(n, game.depot_qp_cost);
 }
 
 Node build_depot(const Node& n)
 {
     Node result = n;
-    result.action.description = "Build a Depot.";
+    result.action = {BUILD_DEPOT, "Build a Depot."};
     result.predecessor = &n;
 
     wait_for_foundation(result);
     use_foundation(result);
-    spend_lc(result, DEPOT_LC_COST);
-    spend_qp(result, DEPOT_QP_COST);
-    result.state.depot_queue.push_back(-DEPOT_BUILD_TIME);
+    spend_lc(result, game.depot_lc_cost);
+    spend_qp(result, game.depot_qp_cost);
+    insert_timer(result.state.depot_queue, -game.depot_build_time);
 
     return result;
 }
@@ -437,21 +577,79 @@ TRY(build_depot);
 
 bool can_build_foundation(const Node& n)
 {
-    return can_spend_lc(n, FOUNDATION_LC_COST);
+    return !n.state.foundation_queue.full() &&
+           can_spend_lc(n, game.foundation_lc_cost);
 }
 
 Node build_foundation(const Node& n)
 {
     Node result = n;
-    result.action.description = "Build a Foundation.";
+    result.action = {BUILD_FOUNDATION, "Build a Foundation."};
     result.predecessor = &n;
 
-    spend_lc(result, FOUNDATION_LC_COST);
-    result.state.foundation_queue.push_back(-FOUNDATION_BUILD_TIME);
+    spend_lc(result, game.foundation_lc_cost);
+    insert_timer(result.state.foundation_queue, -game.foundation_build_time);
 
     return result;
 }
 
 TRY(build_foundation);
 
+// Replay
+
+//! Whether the action with the given id is applicable to n.
+bool can_apply_action(const Node& n, const ActionId id)
+{
+    switch(id)
+    {
+    case BUILD_LC_RP: return can_build_lc_rp(n);
+    case BUILD_QP_RP: return can_build_qp_rp(n);
+    case SWITCH_LC_TO_QP: return can_switch_lc_to_qp(n);
+    case SWITCH_QP_TO_LC: return can_switch_qp_to_lc(n);
+    case BUILD_ZV: return can_build_zv(n);
+    case PILOT_ZP: return can_pilot_zp(n);
+    case BUILD_ZP: return can_build_zp(n);
+    case UPGRADE_ZP: return can_upgrade_zp(n);
+    case BUILD_DEPOT: return can_build_depot(n);
+    case BUILD_FOUNDATION: return can_build_foundation(n);
+    default: return false;
+    }
+}
+
+//! Apply the action with the given id. It must be applicable to n.
+Node apply_action(const Node& n, const ActionId id)
+{
+    switch(id)
+    {
+    case BUILD_LC_RP: return build_lc_rp(n);
+    case BUILD_QP_RP: return build_qp_rp(n);
+    case SWITCH_LC_TO_QP: return switch_lc_to_qp(n);
+    case SWITCH_QP_TO_LC: return switch_qp_to_lc(n);
+    case BUILD_ZV: return build_zv(n);
+    case PILOT_ZP: return pilot_zp(n);
+    case BUILD_ZP: return build_zp(n);
+    case UPGRADE_ZP: return upgrade_zp(n);
+    case BUILD_DEPOT: return build_depot(n);
+    case BUILD_FOUNDATION: return build_foundation(n);
+    default:
+        assert(false && "not a replayable action");
+        return n;
+    }
+}
+
+//! Rebuild a plan from its start node and action sequence.
+BuildOrder replay_solution(const Node& start, const std::vector<ActionId>& actions)
+{
+    BuildOrder result;
+    result.reserve(actions.size() + 1);
+    result.push_back(start);
+    result.front().predecessor = nullptr;
+    for(ActionId id : actions)
+    {
+        // Actions are deterministic, so this reproduces the searched nodes.
+        result.push_back(apply_action(result.back(), id));
+    }
+    return result;
+}
+
 #endif
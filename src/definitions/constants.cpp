@@ -0,0 +1,3 @@
+#include "constants.hpp"
+
+GameConstants game;
@@ -5,49 +5,88 @@
 
 constexpr Time TICKS_PER_SECOND = 18;
 
+// Default starting resources.
 constexpr Resource INITIAL_LC = 60;
 constexpr Resource INITIAL_QP = 40;
 
-// define to use the buggy RP timings
-#define USE_ACHRON_1611_RPS
+constexpr unsigned PULSERS_PER_DEPOT = 7;
 
-#ifdef USE_ACHRON_1611_RPS
-constexpr Time LC_CYCLE_LENGTH = 268;
-constexpr Time QP_CYCLE_LENGTH = 274;
-#else
-constexpr Time LC_CYCLE_LENGTH = 216 + 1;
-constexpr Time QP_CYCLE_LENGTH = 270 + 1;
-#endif
+// Capacity of the inline containers in State. Actions that would exceed them
+// are not applicable. These size every State, so they stay fixed at compile
+// time; they keep it at 128 bytes, two cache lines.
+//
+// The goal is at most MAX_GOAL_ZPS ZPs, which bounds the upgrades. A depot
+// produces at most PULSERS_PER_DEPOT ZPs at once, and the search builds one
+// depot. A foundation or depot is only built while there is none, so their
+// queues hold more only in a start State, and a ZV is only built while an
+// annex is free.
+//
+// Nothing in the game bounds the RPs. An RP repays its LC only after
+// rp_build_time and ten cycles, over 3000 ticks, and the optimal plans known
+// build none; buying RPs with every LC before then would allow over 20 for
+// the largest goal, which would double State. MAX_RPS thus leaves room for
+// nine more than the three at the start, and
+// BuildOrderProblem::capacity_cuts() tells whether a search ran into it.
+constexpr unsigned MAX_GOAL_ZPS = PULSERS_PER_DEPOT + 1;
+constexpr unsigned MAX_RPS = 12;
+constexpr unsigned MAX_QUEUED_FOUNDATIONS = 2;
+constexpr unsigned MAX_QUEUED_DEPOTS = 2;
+constexpr unsigned MAX_QUEUED_ZVS = 4;
+constexpr unsigned MAX_QUEUED_ZPS = PULSERS_PER_DEPOT;
+constexpr unsigned MAX_QUEUED_UPGRADES = MAX_GOAL_ZPS;
 
-constexpr Time RP_SWITCH_TIME = 5 * TICKS_PER_SECOND;
+//! Timings and costs of the game. The defaults are those of Achron 1.6.1.1,
+//! whose RP cycles are longer than intended; see use_fixed_rp_timings().
+struct GameConstants
+{
+    Time lc_cycle_length = 268;
+    Time qp_cycle_length = 274;
 
-constexpr Resource RP_YIELD_SIZE = 8;
-constexpr Resource LC_YIELD_SIZE = RP_YIELD_SIZE;
-constexpr Resource QP_YIELD_SIZE = RP_YIELD_SIZE;
+    Time rp_switch_time = 5 * TICKS_PER_SECOND;
 
-// Structure specs
-constexpr Time RP_BUILD_TIME = 20 * TICKS_PER_SECOND;
-constexpr Resource RP_LC_COST = 80;
+    Resource lc_yield_size = 8;
+    Resource qp_yield_size = 8;
 
-constexpr Time FOUNDATION_BUILD_TIME = 8 * TICKS_PER_SECOND;
-constexpr Time FOUNDATION_LC_COST = 65;
+    // Structure specs
+    Time rp_build_time = 20 * TICKS_PER_SECOND;
+    Resource rp_lc_cost = 80;
 
-constexpr Resource DEPOT_LC_COST = 50;
-constexpr Resource DEPOT_QP_COST = 40;
-constexpr Time DEPOT_BUILD_TIME = 42 * TICKS_PER_SECOND;
+    Time foundation_build_time = 8 * TICKS_PER_SECOND;
+    Resource foundation_lc_cost = 65;
 
-constexpr unsigned PULSERS_PER_DEPOT = 7;
+    Resource depot_lc_cost = 50;
+    Resource depot_qp_cost = 40;
+    Time depot_build_time = 42 * TICKS_PER_SECOND;
+
+    Resource zv_lc_cost = 36;
+    Time zv_build_time = 20 * TICKS_PER_SECOND;
+
+    Resource zp_lc_cost = 29;
+    Resource zp_qp_cost = 15;
+    Time zp_build_time = 32 * TICKS_PER_SECOND;
+
+    Resource skip_upgrade_lc_cost = 25;
+    Resource skip_upgrade_qp_cost = 10;
+    Time skip_upgrade_time = 540;
 
-constexpr Resource ZV_LC_COST = 36;
-constexpr Time ZV_BUILD_TIME = 20 * TICKS_PER_SECOND;
+    //! Piloting a ZP takes what is left of building one after its ZV.
+    Time zp_pilot_time() const
+    {
+        return zp_build_time - zv_build_time;
+    }
 
-constexpr Resource ZP_LC_COST = 29;
-constexpr Resource ZP_QP_COST = 15;
-constexpr Time ZP_BUILD_TIME = 32 * TICKS_PER_SECOND;
-constexpr Time ZP_PILOT_TIME = ZP_BUILD_TIME - ZV_BUILD_TIME;
+    //! The RP timings as intended, without the 1.6.1.1 bug.
+    void use_fixed_rp_timings()
+    {
+        lc_cycle_length = 216 + 1;
+        qp_cycle_length = 270 + 1;
+    }
+};
 
-constexpr Resource SKIP_UPGRADE_LC_COST = 25;
-constexpr Resource SKIP_UPGRADE_QP_COST = 10;
-constexpr Time SKIP_UPGRADE_TIME = 540;
+//! The constants all searches use. Set them, e.g. from a problem
+//! specification, before any search starts; they are read without locking.
+//! Reading them at runtime instead of folding them in at compile time has
+//! no measurable cost, see bench.
+extern GameConstants game;
 
 #endif
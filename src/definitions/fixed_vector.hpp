@@ -0,0 +1,111 @@
+#ifndef PLANNER_FIXED_VECTOR_HPP
+#define PLANNER_FIXED_VECTOR_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+//! Vector with inline storage of compile-time capacity N.
+//! Trivially copyable, so copying a State never touches the allocator.
+template<typename T, std::size_t N>
+class FixedVector
+{
+    static_assert(N <= 255, "FixedVector size is stored in a byte");
+public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    FixedVector() = default;
+
+    //! n copies of value.
+    FixedVector(std::size_t n, const T& value)
+        : count(static_cast<std::uint8_t>(n))
+    {
+        assert(n <= N);
+        std::fill_n(items, n, value);
+    }
+
+    static constexpr std::size_t capacity() { return N; }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == N; }
+
+    iterator begin() { return items; }
+    iterator end() { return items + count; }
+    const_iterator begin() const { return items; }
+    const_iterator end() const { return items + count; }
+
+    T& operator[](std::size_t i) { assert(i < count); return items[i]; }
+    const T& operator[](std::size_t i) const { assert(i < count); return items[i]; }
+
+    T& front() { assert(count > 0); return items[0]; }
+    const T& front() const { assert(count > 0); return items[0]; }
+    T& back() { assert(count > 0); return items[count - 1]; }
+    const T& back() const { assert(count > 0); return items[count - 1]; }
+
+    void push_back(const T& x)
+    {
+        assert(!full());
+        items[count++] = x;
+    }
+
+    void pop_back()
+    {
+        assert(count > 0);
+        items[--count] = T();
+    }
+
+    iterator insert(iterator pos, const T& x)
+    {
+        assert(!full() && pos >= begin() && pos <= end());
+        std::copy_backward(pos, end(), end() + 1);
+        *pos = x;
+        ++count;
+        return pos;
+    }
+
+    iterator erase(iterator pos)
+    {
+        assert(pos >= begin() && pos < end());
+        std::copy(pos + 1, end(), pos);
+        pop_back();
+        return pos;
+    }
+
+    iterator erase(iterator first, iterator last)
+    {
+        assert(first >= begin() && first <= last && last <= end());
+        iterator new_end = std::copy(last, end(), first);
+        std::fill(new_end, end(), T());
+        count = static_cast<std::uint8_t>(new_end - begin());
+        return first;
+    }
+
+    void clear()
+    {
+        std::fill(begin(), end(), T());
+        count = 0;
+    }
+
+private:
+    // Unused slots are kept zeroed so that copies are fully deterministic.
+    T items[N] = {};
+    std::uint8_t count = 0;
+};
+
+template<typename T, std::size_t N>
+inline bool operator==(const FixedVector<T, N>& a, const FixedVector<T, N>& b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template<typename T, std::size_t N>
+inline bool operator!=(const FixedVector<T, N>& a, const FixedVector<T, N>& b)
+{
+    return !(a == b);
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef PLANNER_HASH_HPP
+#define PLANNER_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "fixed_vector.hpp"
+
+// From Boost.Functional/Hash
+template <class T>
+inline void hash_combine(std::size_t& seed, const T& v)
+{
+    std::hash<T> hasher;
+    seed ^= hasher(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+}
+
+template <class T, std::size_t N>
+inline void hash_combine(std::size_t& seed, const FixedVector<T, N>& v)
+{
+    hash_combine(seed, v.size());
+    for(const T& x : v)
+    {
+        hash_combine(seed, x);
+    }
+}
+
+//! Final avalanche step of SplitMix64, so that weak hashes still spread
+//! evenly over a power-of-two table.
+inline std::uint64_t mix_hash(std::uint64_t h)
+{
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+#endif
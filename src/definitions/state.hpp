@@ -4,31 +4,43 @@
 #include <functional>
 #include <iosfwd>
 #include <algorithm>
+#include <type_traits>
 
 #include "constants.hpp"
+#include "fixed_vector.hpp"
+#include "hash.hpp"
 
+typedef FixedVector<Timer, MAX_RPS> RPState;
+template<std::size_t N> using ProductionState = FixedVector<Timer, N>;
+
+//! The RP timers and production queues are multisets, kept sorted from most
+//! to least advanced so that equal States compare and hash equal. Use
+//! insert_timer() to add to them.
 struct State
 {
     Resource lc = INITIAL_LC, qp = INITIAL_QP;
 
-    unsigned annexes = 1;
-    unsigned depots = 0;
-    unsigned foundations = 0;
-    unsigned zvs = 1;
-    unsigned zps = 0;
-    unsigned upgraded_zps = 0;
+    Count annexes = 1;
+    Count depots = 0;
+    Count foundations = 0;
+    Count zvs = 1;
+    Count zps = 0;
+    Count upgraded_zps = 0;
 
-    RPState lc_rp_state = {-5 * TICKS_PER_SECOND, -5 * TICKS_PER_SECOND, -5 * TICKS_PER_SECOND};
+    RPState lc_rp_state = RPState(3, -5 * TICKS_PER_SECOND);
     RPState qp_rp_state;
 
-    ProductionState foundation_queue;
-    ProductionState depot_queue;
+    ProductionState<MAX_QUEUED_FOUNDATIONS> foundation_queue;
+    ProductionState<MAX_QUEUED_DEPOTS> depot_queue;
 
-    ProductionState zv_queue;
-    ProductionState zp_queue;
-    ProductionState zp_upgrade_queue;
+    ProductionState<MAX_QUEUED_ZVS> zv_queue;
+    ProductionState<MAX_QUEUED_ZPS> zp_queue;
+    ProductionState<MAX_QUEUED_UPGRADES> zp_upgrade_queue;
 };
 
+static_assert(std::is_trivially_copyable<State>::value, "State must be cheap to copy");
+static_assert(sizeof(State) <= 128, "State should fit in two cache lines");
+
 inline bool operator==(const State& a, const State& b)
 {
     return a.lc == b.lc && a.qp == b.qp &&
@@ -50,14 +62,6 @@ inline bool operator==(const State& a, const State& b)
            a.zp_upgrade_queue == b.zp_upgrade_queue;
 }
 
-// From Boost.Functional/Hash
-template <class T>
-inline void hash_combine(std::size_t& seed, const T& v)
-{
-    std::hash<T> hasher;
-    seed ^= hasher(v) + 0x9e3779b9 + (seed<<6) + (seed>>2);
-}
-
 namespace std {
     template <> struct hash<State>
     {
@@ -68,16 +72,17 @@ namespace std {
             hash_combine(seed, state.qp);
             hash_combine(seed, state.annexes);
             hash_combine(seed, state.depots);
+            hash_combine(seed, state.foundations);
             hash_combine(seed, state.zvs);
             hash_combine(seed, state.zps);
             hash_combine(seed, state.upgraded_zps);
-            hash_combine(seed, state.lc_rp_state.size());
-            hash_combine(seed, state.qp_rp_state.size());
-            hash_combine(seed, state.foundation_queue.size());
-            hash_combine(seed, state.depot_queue.size());
-            hash_combine(seed, state.zv_queue.size());
-            hash_combine(seed, state.zp_queue.size());
-            hash_combine(seed, state.zp_upgrade_queue.size());
+            hash_combine(seed, state.lc_rp_state);
+            hash_combine(seed, state.qp_rp_state);
+            hash_combine(seed, state.foundation_queue);
+            hash_combine(seed, state.depot_queue);
+            hash_combine(seed, state.zv_queue);
+            hash_combine(seed, state.zp_queue);
+            hash_combine(seed, state.zp_upgrade_queue);
 
             return seed;
         }
@@ -87,7 +92,7 @@ namespace std {
 struct Node
 {
     const Node* predecessor = nullptr;
-    Action action = {"<no action>"};
+    Action action = {NO_ACTION, "<no action>"};
     Time t;
 
     State state;
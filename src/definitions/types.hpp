@@ -1,20 +1,39 @@
 #ifndef PLANNER_TYPES_HPP
 #define PLANNER_TYPES_HPP
 
+#include <cstdint>
 #include <vector>
 
 struct Node;
 
 typedef int Time;
+// Compact storage for per-structure countdowns; arithmetic is done in Time.
+typedef std::int16_t Timer;
+// Compact storage for unit and structure counts.
+typedef std::uint16_t Count;
 typedef unsigned int Resource;
 typedef std::vector<Node> BuildOrder;
 
+enum ActionId : std::uint8_t
+{
+    NO_ACTION,
+    BUILD_LC_RP,
+    BUILD_QP_RP,
+    SWITCH_LC_TO_QP,
+    SWITCH_QP_TO_LC,
+    BUILD_ZV,
+    PILOT_ZP,
+    BUILD_ZP,
+    UPGRADE_ZP,
+    BUILD_DEPOT,
+    BUILD_FOUNDATION,
+    NUM_ACTIONS
+};
+
 struct Action
 {
+    ActionId id;
     const char* description;
 };
 
-typedef std::vector<Time> RPState;
-typedef std::vector<Time> ProductionState;
-
 #endif
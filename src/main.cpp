@@ -1,29 +1,411 @@
+#include <algorithm>
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
-
-// define to use branch and bound instead of A*
-// #define USE_DFBB
-
-#ifdef USE_DFBB
-#include "solvers/dfbb.hpp"
-#else
-#include "solvers/astar.hpp"
-#endif
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "problems/buildorder.hpp"
+#include "problems/solution_store.hpp"
+#include "problems/specification.hpp"
 #include "definitions/types.hpp"
+#include "service/planner_service.hpp"
+#include "service/unix_socket.hpp"
+#include "solvers/batch.hpp"
+#include "solvers/dispatch.hpp"
+#include "solvers/stop_token.hpp"
+
+const char USAGE[] =
+    "usage: baryon [options] [specification]\n"
+    "\n"
+    "Plan the build order of the specification file, or of the default problem.\n"
+    "With --batch, plan every problem of the batch file on top of it instead,\n"
+    "printing a line of JSON for each as it is done. With --serve, answer\n"
+    "requests for plans until stopped; with --client, send them to a server.\n"
+    "\n"
+    "  --solver NAME          astar (default), dfbb, ida, parallel-dfbb, hdastar,\n"
+    "                         external-astar or arastar\n"
+    "  --set KEY=VALUE        override an entry of the specification\n"
+    "  --zps N                same as --set goal.zps=N\n"
+    "  --time-limit SECONDS   stop with the best plan found so far, 0 for no limit\n"
+    "  --report-interval S    seconds between progress reports, 0 to disable\n"
+    "  --no-dominance         astar, dfbb: keep States dominated by others\n"
+    "  --memory-budget MB     astar, hdastar: hand over to IDA* beyond this, 0 for\n"
+    "                         no limit\n"
+    "  --threads N            parallel-dfbb, hdastar: worker threads\n"
+    "  --scratch DIR          external-astar: directory for the search files,\n"
+    "                         created if missing\n"
+    "  --partitions N         external-astar: hash partitions of the search files\n"
+    "  --buffer MB            external-astar: successors, and closed States, to\n"
+    "                         keep in memory before writing them out\n"
+    "  --store PATH           keep plans and bounds in this file across runs, and\n"
+    "                         answer from it when it knows the optimal plan\n"
+    "  --batch FILE           solve the problems of the [name] sections of FILE\n"
+    "  --serve                answer the requests on stdin, or on the socket\n"
+    "  --socket PATH          with --serve, listen on this Unix domain socket\n"
+    "  --client PATH          send the problem, or those of --batch, to the\n"
+    "                         server at PATH and print its answers\n"
+    "  --jobs N               with --batch or --serve, problems to solve at once\n"
+    "                         (default: one per core); budget and threads are\n"
+    "                         split between them unless given\n"
+    "  --print-spec           print the specification in effect and exit\n"
+    "  --help                 print this and exit\n";
+
+struct CommandLine
+{
+    ProblemSpecification spec;
+    SolverOptions solver;
+    double time_limit = 0;
+    bool print_spec = false;
+    const char* batch_file = nullptr;
+    bool serve = false;
+    const char* socket_path = nullptr;
+    const char* client_path = nullptr;
+    const char* store_path = nullptr;
+    unsigned jobs = std::thread::hardware_concurrency();
+    bool memory_budget_given = false;
+    bool threads_given = false;
+};
+
+double parse_number(const char* option, const char* value)
+{
+    char* end;
+    double x = std::strtod(value, &end);
+    if(end == value || *end != '\0' || !(x >= 0))
+        throw std::runtime_error(std::string(option) + ": expected a non-negative number, got '" + value + "'");
+    return x;
+}
+
+//! Parse the arguments. The specification file is read first, then --set
+//! and --zps apply on top of it in order. Throws std::runtime_error.
+CommandLine parse_command_line(int argc, char** argv)
+{
+    CommandLine cl;
+    std::vector<std::pair<std::string, std::string>> overrides;
+    const char* spec_file = nullptr;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        auto value = [&]() -> const char* {
+            if(i + 1 >= argc)
+                throw std::runtime_error(std::string(arg) + " needs a value");
+            return argv[++i];
+        };
+
+        if(!std::strcmp(arg, "--help"))
+        {
+            std::cout << USAGE;
+            std::exit(0);
+        }
+        else if(!std::strcmp(arg, "--solver"))
+        {
+            cl.solver.kind = parse_solver_kind(value());
+        }
+        else if(!std::strcmp(arg, "--set"))
+        {
+            std::string kv = value();
+            std::size_t eq = kv.find('=');
+            if(eq == std::string::npos)
+                throw std::runtime_error("--set: expected KEY=VALUE, got '" + kv + "'");
+            overrides.emplace_back(kv.substr(0, eq), kv.substr(eq + 1));
+        }
+        else if(!std::strcmp(arg, "--zps"))
+        {
+            overrides.emplace_back("goal.zps", value());
+        }
+        else if(!std::strcmp(arg, "--time-limit"))
+        {
+            cl.time_limit = parse_number(arg, value());
+        }
+        else if(!std::strcmp(arg, "--report-interval"))
+        {
+            cl.solver.report_interval = parse_number(arg, value());
+        }
+        else if(!std::strcmp(arg, "--no-dominance"))
+        {
+            cl.solver.dominance_pruning = false;
+        }
+        else if(!std::strcmp(arg, "--memory-budget"))
+        {
+            cl.solver.memory_budget = std::size_t(parse_number(arg, value())) << 20;
+            cl.memory_budget_given = true;
+        }
+        else if(!std::strcmp(arg, "--threads"))
+        {
+            cl.solver.threads = parse_number(arg, value());
+            if(cl.solver.threads == 0)
+                throw std::runtime_error("--threads: expected at least 1");
+            cl.threads_given = true;
+        }
+        else if(!std::strcmp(arg, "--scratch"))
+        {
+            cl.solver.scratch_directory = value();
+        }
+        else if(!std::strcmp(arg, "--partitions"))
+        {
+            cl.solver.partitions = parse_number(arg, value());
+            if(cl.solver.partitions == 0)
+                throw std::runtime_error("--partitions: expected at least 1");
+        }
+        else if(!std::strcmp(arg, "--buffer"))
+        {
+            cl.solver.external_buffer = std::size_t(parse_number(arg, value()) * (1 << 20));
+        }
+        else if(!std::strcmp(arg, "--store"))
+        {
+            cl.store_path = value();
+        }
+        else if(!std::strcmp(arg, "--batch"))
+        {
+            cl.batch_file = value();
+        }
+        else if(!std::strcmp(arg, "--serve"))
+        {
+            cl.serve = true;
+        }
+        else if(!std::strcmp(arg, "--socket"))
+        {
+            cl.socket_path = value();
+        }
+        else if(!std::strcmp(arg, "--client"))
+        {
+            cl.client_path = value();
+        }
+        else if(!std::strcmp(arg, "--jobs"))
+        {
+            cl.jobs = parse_number(arg, value());
+            if(cl.jobs == 0)
+                throw std::runtime_error("--jobs: expected at least 1");
+        }
+        else if(!std::strcmp(arg, "--print-spec"))
+        {
+            cl.print_spec = true;
+        }
+        else if(arg[0] == '-' || spec_file != nullptr)
+        {
+            throw std::runtime_error(std::string("unexpected argument '") + arg + "'");
+        }
+        else
+        {
+            spec_file = arg;
+        }
+    }
+
+    if(spec_file != nullptr)
+    {
+        std::ifstream is(spec_file);
+        if(!is)
+            throw std::runtime_error(std::string("cannot open ") + spec_file);
+        try
+        {
+            read_specification(is, cl.spec);
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw std::runtime_error(std::string(spec_file) + ": " + e.what());
+        }
+    }
+    for(const auto& kv : overrides)
+    {
+        set_specification_value(cl.spec, kv.first, kv.second);
+    }
+    check_specification(cl.spec);
+    if(cl.socket_path != nullptr && !cl.serve)
+        throw std::runtime_error("--socket needs --serve");
+    if(cl.serve && cl.client_path != nullptr)
+        throw std::runtime_error("--serve and --client do not go together");
+    if(cl.store_path != nullptr && cl.client_path != nullptr)
+        throw std::runtime_error("--store and --client do not go together");
 
-int main()
+    if(cl.batch_file != nullptr || cl.serve)
+    {
+        cl.jobs = std::max(cl.jobs, 1u);
+        if(!cl.memory_budget_given)
+        {
+            cl.solver.memory_budget /= cl.jobs;
+        }
+        if(!cl.threads_given)
+        {
+            cl.solver.threads = std::max(cl.solver.threads / cl.jobs, 1u);
+        }
+    }
+    return cl;
+}
+
+//! Read the problems of the batch file on top of the specification in cl.
+//! Throws std::runtime_error.
+std::vector<BatchInstance> read_batch_file(const CommandLine& cl)
 {
-#ifdef USE_DFBB
-    DFBBSolver<BuildOrderProblem> solver;
-#else
-    AStarSolver<BuildOrderProblem> solver;
-#endif
-    BuildOrder solution;
+    std::ifstream is(cl.batch_file);
+    try
+    {
+        if(!is)
+            throw std::runtime_error("cannot open it");
+        return read_batch(is, cl.spec);
+    }
+    catch(const std::runtime_error& e)
+    {
+        throw std::runtime_error(std::string(cl.batch_file) + ": " + e.what());
+    }
+}
+
+volatile std::sig_atomic_t quit_requested = 0;
 
-    if(solver.solve(solution))
+extern "C" void request_quit(int)
+{
+    quit_requested = 1;
+}
+
+//! Answer requests until the end of stdin, or on the socket until SIGINT or
+//! SIGTERM. Requests start from the specification, solver and time limit
+//! in cl.
+void serve(const CommandLine& cl)
+{
+    ServiceRequest defaults;
+    defaults.spec = cl.spec;
+    defaults.solver = cl.solver.kind;
+    defaults.time_limit = cl.time_limit;
+    PlannerService service(cl.solver, cl.jobs);
+
+    if(cl.socket_path != nullptr)
+    {
+        std::signal(SIGINT, request_quit);
+        std::signal(SIGTERM, request_quit);
+        serve_unix_socket(service, cl.socket_path, defaults, quit_requested);
+        return;
+    }
+
+    std::mutex output;
+    auto next_line = [](std::string& line) { return bool(std::getline(std::cin, line)); };
+    ServiceRequest request;
+    std::string error;
+    while(read_request(next_line, defaults, request, error))
+    {
+        service.submit(request, error, [&output](const std::string& answer) {
+            std::lock_guard<std::mutex> lock(output);
+            std::cout << answer << std::flush;
+        });
+    }
+    service.wait_idle();
+}
+
+//! Send the problem in cl, or those of its batch file, to the server and
+//! print its answers.
+void run_client(const CommandLine& cl)
+{
+    std::vector<BatchInstance> instances;
+    if(cl.batch_file != nullptr)
+    {
+        instances = read_batch_file(cl);
+    }
+    else
+    {
+        instances.push_back(BatchInstance {"request", cl.spec});
+    }
+
+    std::ostringstream request;
+    for(const BatchInstance& instance : instances)
+    {
+        request << '[' << instance.name << "]\n"
+                << "solver = " << solver_name(cl.solver.kind) << '\n'
+                << "time_limit = " << cl.time_limit << '\n';
+        write_specification(request, instance.spec);
+        request << '\n';
+    }
+    request_unix_socket(cl.client_path, request.str(), [](const std::string& answer) {
+        std::cout << answer << std::endl;
+    });
+}
+
+int main(int argc, char** argv)
+{
+    CommandLine cl;
+    try
+    {
+        cl = parse_command_line(argc, argv);
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cerr << "baryon: " << e.what() << "\n\n" << USAGE;
+        return 2;
+    }
+
+    if(cl.print_spec)
+    {
+        write_specification(std::cout, cl.spec);
+        return 0;
+    }
+    try
+    {
+        if(cl.store_path != nullptr)
+        {
+            cl.solver.store = std::make_shared<SolutionStore>(cl.store_path);
+        }
+        if(cl.client_path != nullptr)
+        {
+            run_client(cl);
+            return 0;
+        }
+        if(cl.serve)
+        {
+            serve(cl);
+            return 0;
+        }
+        if(cl.batch_file != nullptr)
+        {
+            run_batch(read_batch_file(cl), cl.solver, cl.jobs, cl.time_limit, std::cout);
+            return 0;
+        }
+    }
+    catch(const std::runtime_error& e)
+    {
+        std::cerr << "baryon: " << e.what() << std::endl;
+        return 2;
+    }
+
+    cl.spec.apply_constants();
+    cl.solver.on_improvement = [](const BuildOrder& plan, double bound) {
+        std::cerr << "Plan within " << bound << "x of optimal:\n";
+        for(auto n = plan.begin() + 1; n != plan.end(); ++n)
+        {
+            std::cerr << *n << '\n';
+        }
+        std::cerr << std::endl;
+    };
+
+    SolveResult r = solve_specification(cl.spec, cl.solver, std::make_shared<GatherCache>(), cl.time_limit, nullptr);
+    if(!r.error.empty())
+    {
+        std::cerr << "baryon: " << r.error << std::endl;
+        return 2;
+    }
+    if(r.reused)
+    {
+        std::cerr << "Optimal plan from " << cl.store_path << "." << std::endl;
+    }
+    if(r.stats.capacity_cuts > 0)
+    {
+        std::cerr << "Warning: " << r.stats.capacity_cuts << " nodes could not build an RP for lack of room in State; "
+                  << "the plan is only optimal among those with at most " << MAX_RPS << " RPs." << std::endl;
+    }
+    if(r.stats.stopped)
+    {
+        std::cerr << "Stopped early; no plan takes less than " << r.stats.lower_bound << " ticks." << std::endl;
+    }
+    if(r.solved)
     {
-        print_solution(solution);
+        print_solution(r.plan);
         return 0;
     }
     else
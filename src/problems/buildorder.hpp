@@ -4,31 +4,22 @@
 #include "definitions/types.hpp"
 #include "definitions/state.hpp"
 #include "definitions/actions.hpp"
+#include "problems/heuristic_cache.hpp"
+#include "problems/search_memory.hpp"
 
-Time time_to_lc(State base, const Resource lc) {
-    if(lc <= base.lc)
-        return 0;
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
 
-    Time dt = 0;
-    int full_cycles = ((lc - base.lc) / LC_YIELD_SIZE) / base.lc_rp_state.size();
-    dt += full_cycles * LC_CYCLE_LENGTH;
-    if(dt > 0)
-    {
-        update(base, dt);
-    }
-
-    while(base.lc < lc)
-    {
-        update(base, 1);
-        ++dt;
-    }
-    return dt;
+Time time_to_lc(const State& base, const Resource lc) {
+    return time_to_resource(base.lc, lc, base.lc_rp_state, game.lc_cycle_length, game.lc_yield_size);
 }
 
 Time min_time_to_gather_lc(Node n, const Resource lc) {
     for(std::size_t i = 0; i < n.state.qp_rp_state.size(); ++i)
     {
-        n.state.lc_rp_state.push_back(-RP_SWITCH_TIME);
+        insert_timer(n.state.lc_rp_state, -game.rp_switch_time);
     }
     n.state.qp_rp_state.clear();
 
@@ -61,40 +52,191 @@ Time min_time_to_gather_lc(Node n, const Resource lc) {
     return t;
 }
 
+//! Whether a and b, done at the same tick, lead to the same State in either
+//! order, and either order is offered by BuildOrderProblem::visit_neighbors().
+//! Actions only spend resources and use or queue units, so that holds unless
+//! one changes what the other depends on: switches change the income.
+//! Building a ZP is only offered while at most one ZV is ready, and the wait
+//! of any action before it can let a queued ZV finish, so the order with the
+//! ZP built first may be the only one offered; it commutes with nothing.
+bool commute(const ActionId a, const ActionId b)
+{
+    auto is_switch = [](const ActionId id) {
+        return id == SWITCH_LC_TO_QP || id == SWITCH_QP_TO_LC;
+    };
+    if(is_switch(a) || is_switch(b))
+        return false;
+
+    return a != BUILD_ZP && b != BUILD_ZP;
+}
+
+//! The part of a Node that min_time_to_gather_lc() depends on. QP RPs are
+//! all switched to LC first, so only their number matters.
+struct GatherKey
+{
+    Resource lc;
+    Resource target;
+    unsigned annexes;
+    unsigned zvs;
+    unsigned qp_rps;
+    RPState lc_rp_state;
+    ProductionState<MAX_QUEUED_ZVS> zv_queue;
+
+    GatherKey(const Node& n, const Resource target_)
+        : lc(n.state.lc)
+        , target(target_)
+        , annexes(n.state.annexes)
+        , zvs(n.state.zvs)
+        , qp_rps(n.state.qp_rp_state.size())
+        , lc_rp_state(n.state.lc_rp_state)
+        , zv_queue(n.state.zv_queue)
+    {
+    }
+
+    GatherKey() = default;
+};
+
+inline bool operator==(const GatherKey& a, const GatherKey& b)
+{
+    return a.lc == b.lc && a.target == b.target &&
+           a.annexes == b.annexes && a.zvs == b.zvs && a.qp_rps == b.qp_rps &&
+           a.lc_rp_state == b.lc_rp_state && a.zv_queue == b.zv_queue;
+}
+
+namespace std {
+    template <> struct hash<GatherKey>
+    {
+        size_t operator()(const GatherKey& k) const
+        {
+            std::size_t seed = 0;
+            hash_combine(seed, k.lc);
+            hash_combine(seed, k.target);
+            hash_combine(seed, k.annexes);
+            hash_combine(seed, k.zvs);
+            hash_combine(seed, k.qp_rps);
+            hash_combine(seed, k.lc_rp_state);
+            hash_combine(seed, k.zv_queue);
+            return seed;
+        }
+    };
+}
+
+typedef HeuristicCache<GatherKey, Time> GatherCache;
+
+//! Default goal: number of upgraded ZPs.
 constexpr unsigned NUM_ZPS = 2;
 
 class BuildOrderProblem
 {
 public:
+    //! Plan from start, reached at tick start_time, until num_zps ZPs are
+    //! upgraded or being upgraded. Copies share the cache, so each solver
+    //! thread can have its own copy. The cached values depend only on the
+    //! game constants, so problems with the same constants may share a cache
+    //! too.
+    BuildOrderProblem(unsigned num_zps_ = NUM_ZPS, const State& start_ = State(), Time start_time_ = 0, std::shared_ptr<GatherCache> cache = std::make_shared<GatherCache>())
+        : num_zps(num_zps_)
+        , start(start_)
+        , start_time(start_time_)
+        , gather_cache(std::move(cache))
+        , rp_capacity_cuts(std::make_shared<std::atomic<std::size_t>>(0))
+    {
+        assert(num_zps >= 1 && num_zps <= MAX_GOAL_ZPS);
+        canonicalize(start);
+    }
+
+    //! Raise the heuristic to the bounds earlier searches for the same goal
+    //! and constants proved, if memory is not null. It must neither change
+    //! nor go away while a search uses this problem.
+    void set_search_memory(const SearchMemory* memory)
+    {
+        search_memory = memory;
+    }
+
+    //! Tell the problem that no plan from the start takes less than lower
+    //! ticks, and that one takes upper ticks, or NEVER if none is known; see
+    //! SolutionStore.
+    void set_known_bounds(Time lower, Time upper)
+    {
+        known_lower = lower;
+        known_upper = upper;
+    }
+
     Node start_node()
     {
-        Node start;
-        start.t = 0;
-        return start;
+        Node n;
+        n.t = start_time;
+        n.state = start;
+        return n;
     }
 
-    //! Return initial upper bound for plan length.
+    //! Return initial upper bound for plan length: one past the end of a
+    //! simple plan, or of the known plan if it is shorter, or NEVER if
+    //! neither is possible from the start. The simple plan first gets an RP
+    //! of each kind if it can, and pilots the ZVs there are if no annex can
+    //! build ZPs.
     Time upper_bound()
     {
+        Time known = known_upper != NEVER ? start_time + known_upper + 1 : NEVER;
         Node n = start_node();
-        n = build_qp_rp(n);
-        n = build_foundation(n);
-        n = build_depot(n);
-        for(unsigned i = 0; i < NUM_ZPS; ++i)
+        if(n.state.lc_rp_state.empty())
         {
-            n = build_zp(n);
+            if(can_switch_qp_to_lc(n))
+            {
+                n = switch_qp_to_lc(n);
+            }
+            else if(can_build_lc_rp(n))
+            {
+                n = build_lc_rp(n);
+            }
         }
-        for(unsigned i = 0; i < NUM_ZPS; ++i)
+        if(can_build_qp_rp(n))
         {
+            n = build_qp_rp(n);
+        }
+        else if(n.state.qp_rp_state.empty() && n.state.lc_rp_state.size() >= 2)
+        {
+            n = switch_lc_to_qp(n);
+        }
+        if(!has_depot(n))
+        {
+            if(!has_foundation(n))
+            {
+                if(!can_build_foundation(n))
+                    return known;
+                n = build_foundation(n);
+            }
+            if(!can_build_depot(n))
+                return known;
+            n = build_depot(n);
+        }
+        while(n.state.zp_upgrade_queue.size() + n.state.upgraded_zps + n.state.zp_queue.size() + n.state.zps < num_zps)
+        {
+            if(can_build_zp(n))
+            {
+                n = build_zp(n);
+            }
+            else if(can_pilot_zp(n))
+            {
+                n = pilot_zp(n);
+            }
+            else
+            {
+                return known;
+            }
+        }
+        while(!is_goal(n))
+        {
+            if(!can_upgrade_zp(n))
+                return known;
             n = upgrade_zp(n);
         }
-        assert(is_goal(n));
-        return n.t + 1;
+        return std::min(n.t + 1, known);
     }
 
     bool is_goal(const Node& n)
     {
-        return n.state.zp_upgrade_queue.size() + n.state.upgraded_zps >= NUM_ZPS;
+        return n.state.zp_upgrade_queue.size() + n.state.upgraded_zps >= num_zps;
     }
 
     //! Return lower bound on time to goal from given node.
@@ -113,42 +255,63 @@ public:
             {
                 if(!has_foundation(n))
                 {
-                    build_wait += FOUNDATION_BUILD_TIME;
-                    lc_cost += FOUNDATION_LC_COST;
+                    build_wait += game.foundation_build_time;
+                    lc_cost += game.foundation_lc_cost;
                 }
-                build_wait += DEPOT_BUILD_TIME;
-                lc_cost += DEPOT_LC_COST;
-                // lc_cost += (QP_CYCLE_LENGTH * DEPOT_QP_COST) / LC_CYCLE_LENGTH;
+                build_wait += game.depot_build_time;
+                lc_cost += game.depot_lc_cost;
+                // lc_cost += (game.qp_cycle_length * game.depot_qp_cost) / game.lc_cycle_length;
             }
         }
 
         unsigned zps_upgraded = n.state.zp_upgrade_queue.size() + n.state.upgraded_zps;
-        if(zps_upgraded < NUM_ZPS)
+        if(zps_upgraded < num_zps)
         {
-            lc_cost += SKIP_UPGRADE_LC_COST * (NUM_ZPS - zps_upgraded);
-            // lc_cost += (QP_CYCLE_LENGTH * SKIP_UPGRADE_QP_COST) / LC_CYCLE_LENGTH * (NUM_ZPS - zps_upgraded);
+            lc_cost += game.skip_upgrade_lc_cost * (num_zps - zps_upgraded);
+            // lc_cost += (game.qp_cycle_length * game.skip_upgrade_qp_cost) / game.lc_cycle_length * (num_zps - zps_upgraded);
         }
 
         unsigned zps_produced = zps_upgraded + n.state.zp_queue.size() + n.state.zps;
-        if(zps_produced < NUM_ZPS)
+        if(zps_produced < num_zps)
         {
-            lc_cost += ZP_LC_COST * (NUM_ZPS - zps_produced);
-            // lc_cost += (QP_CYCLE_LENGTH * ZP_QP_COST) / LC_CYCLE_LENGTH * (NUM_ZPS - zps_produced);
-            build_wait += ZP_PILOT_TIME;
+            lc_cost += game.zp_lc_cost * (num_zps - zps_produced);
+            // lc_cost += (game.qp_cycle_length * game.zp_qp_cost) / game.lc_cycle_length * (num_zps - zps_produced);
+            build_wait += game.zp_pilot_time();
         }
 
         unsigned zvs_produced = zps_produced + n.state.zv_queue.size() + n.state.zvs;
-        if(zvs_produced < NUM_ZPS)
+        if(zvs_produced < num_zps)
         {
-            lc_cost += ZV_LC_COST * (NUM_ZPS - zvs_produced);
+            lc_cost += game.zv_lc_cost * (num_zps - zvs_produced);
         }
 
-        return std::max(build_wait, min_time_to_gather_lc(n, lc_cost));
+        Time h = std::max(build_wait, cached_time_to_gather_lc(n, lc_cost));
+        if(search_memory != nullptr)
+        {
+            h = std::max(h, search_memory->bound(n.state));
+        }
+        if(known_lower > 0 && n.state == start)
+        {
+            h = std::max(h, known_lower);
+        }
+        return h;
     }
 
     template<typename T>
-    void visit_neighbors(const Node& n, T visitor)
+    void visit_neighbors(const Node& n, T next)
     {
+        // Of two commuting actions done at the same tick, only the order with
+        // the lower ActionId first is expanded. The other order's successor
+        // would be reached at the same time by doing the later action first,
+        // at this tick or before, then the earlier one, which dominates it.
+        // What a search learns below n thus depends on n's action too; see
+        // TranspositionTable.
+        auto visitor = [&n, &next](Node&& succ) {
+            if(succ.t == n.t && succ.action.id < n.action.id && commute(succ.action.id, n.action.id))
+                return;
+            next(std::move(succ));
+        };
+
         // For up to 7 ZPs, we only need 1 Depot.
         if(!has_depot(n))
         {
@@ -168,12 +331,55 @@ public:
         try_pilot_zp(n, visitor);
         try_upgrade_zp(n, visitor);
 
+        if(!has_rp_slot(n) && has_zv(n))
+        {
+            rp_capacity_cuts->fetch_add(1, std::memory_order_relaxed);
+        }
         try_build_lc_rp(n, visitor);
         try_build_qp_rp(n, visitor);
 
         try_switch_lc_to_qp(n, visitor);
         try_switch_qp_to_lc(n, visitor);
     }
+
+    const GatherCache& heuristic_cache() const
+    {
+        return *gather_cache;
+    }
+
+    //! How many expanded nodes could not build an RP only because State
+    //! holds no more than MAX_RPS of them, over this problem and its
+    //! copies. If not 0, plans are only optimal among those with at most
+    //! MAX_RPS RPs.
+    std::size_t capacity_cuts() const
+    {
+        return rp_capacity_cuts->load(std::memory_order_relaxed);
+    }
+
+private:
+    Time cached_time_to_gather_lc(const Node& n, const Resource lc)
+    {
+        if(lc <= n.state.lc)
+            return 0;
+
+        GatherKey key(n, lc);
+        Time t;
+        if(!gather_cache->lookup(key, t))
+        {
+            t = min_time_to_gather_lc(n, lc);
+            gather_cache->store(key, t);
+        }
+        return t;
+    }
+
+    unsigned num_zps;
+    State start;
+    Time start_time;
+    std::shared_ptr<GatherCache> gather_cache;
+    std::shared_ptr<std::atomic<std::size_t>> rp_capacity_cuts;
+    const SearchMemory* search_memory = nullptr;
+    Time known_lower = 0;
+    Time known_upper = NEVER;
 };
 
 #endif
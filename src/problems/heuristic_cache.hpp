@@ -0,0 +1,106 @@
+#ifndef PLANNER_HEURISTIC_CACHE_HPP
+#define PLANNER_HEURISTIC_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "definitions/hash.hpp"
+
+//! Fixed-size, thread-safe memo table for heuristic values.
+//!
+//! Direct-mapped: every key has exactly one slot, and storing into an
+//! occupied slot evicts whatever was there. The table is split into shards
+//! with one mutex each, so threads rarely wait on each other.
+template<typename K, typename V, typename Hash = std::hash<K>>
+class HeuristicCache
+{
+public:
+    //! capacity is rounded up to a power of two.
+    explicit HeuristicCache(std::size_t capacity = 1 << 18)
+        : shards(new Shard[NUM_SHARDS])
+        , hits(0)
+        , misses(0)
+    {
+        std::size_t per_shard = 1;
+        while(per_shard * NUM_SHARDS < capacity)
+        {
+            per_shard *= 2;
+        }
+        for(std::size_t i = 0; i < NUM_SHARDS; ++i)
+        {
+            shards[i].entries.resize(per_shard);
+        }
+    }
+
+    //! Look k up, setting v and returning true on a hit.
+    bool lookup(const K& k, V& v)
+    {
+        std::uint64_t h = mix_hash(hasher(k));
+        Shard& shard = shard_for(h);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            const Entry& e = shard.entries[slot_for(shard, h)];
+            if(e.valid && e.key == k)
+            {
+                v = e.value;
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void store(const K& k, const V& v)
+    {
+        std::uint64_t h = mix_hash(hasher(k));
+        Shard& shard = shard_for(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Entry& e = shard.entries[slot_for(shard, h)];
+        e.key = k;
+        e.value = v;
+        e.valid = true;
+    }
+
+    std::size_t hit_count() const { return hits.load(std::memory_order_relaxed); }
+    std::size_t miss_count() const { return misses.load(std::memory_order_relaxed); }
+
+    std::size_t capacity() const { return NUM_SHARDS * shards[0].entries.size(); }
+    std::size_t memory_usage() const { return capacity() * sizeof(Entry); }
+
+private:
+    struct Entry
+    {
+        K key;
+        V value;
+        bool valid = false;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::vector<Entry> entries;
+    };
+
+    static constexpr std::size_t NUM_SHARDS = 64;
+
+    Shard& shard_for(std::uint64_t h) { return shards[h % NUM_SHARDS]; }
+
+    static std::size_t slot_for(const Shard& shard, std::uint64_t h)
+    {
+        // The low bits picked the shard.
+        return (h >> 32) & (shard.entries.size() - 1);
+    }
+
+    Hash hasher;
+    std::unique_ptr<Shard[]> shards;
+    std::atomic<std::size_t> hits;
+    std::atomic<std::size_t> misses;
+};
+
+#endif
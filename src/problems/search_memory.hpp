@@ -0,0 +1,242 @@
+#ifndef PLANNER_SEARCH_MEMORY_HPP
+#define PLANNER_SEARCH_MEMORY_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "solvers/flat_hash.hpp"
+
+//! Most States a SearchMemory learns bounds for; it stops learning new ones
+//! beyond that.
+constexpr std::size_t SEARCH_MEMORY_STATES = 1 << 20;
+
+//! Most plans a SearchMemory keeps; beyond that it forgets the older half,
+//! so that looking for a continuation stays cheap.
+constexpr std::size_t SEARCH_MEMORY_PLANS = 64;
+
+//! What earlier searches proved about the time from a State to the goal, for
+//! later searches toward the same goal under the same game constants.
+//!
+//! Nothing in the game depends on the tick a State is reached at, so the
+//! time to the goal depends on the State alone. That gives two kinds of
+//! reuse when replanning from a State further along a plan:
+//!
+//! - Every State past the start of an optimal plan, or between two of its
+//!   actions, has the rest of that plan as an optimal continuation; see
+//!   continuation().
+//! - A search that found an optimal plan of cost C and reached a State at g
+//!   proves that the goal is at least C - g away from it, as a path through
+//!   it would otherwise be cheaper (Adaptive A*, Koenig and Likhachev). These
+//!   bounds can be far above the heuristic; see bound().
+//! - The rest of a plan, done from a State near one it passes through, is
+//!   often still a plan, if not an optimal one; see repair(). It bounds a
+//!   search from above.
+//!
+//! The bounds only help A* where it reaches the States of earlier
+//! searches. States hold the timers of every RP and queue, so after the
+//! game strays from a plan by a few ticks most of those it reaches are
+//! new, and the search expands about as much as one from scratch. A*
+//! then only gains from the upper bound of repair(), which keeps it from
+//! storing nodes that cannot beat it; DFBB gains more.
+//!
+//! Not thread-safe: learn only while no search is reading.
+class SearchMemory
+{
+public:
+    explicit SearchMemory(std::size_t max_states_ = SEARCH_MEMORY_STATES, std::size_t max_plans_ = SEARCH_MEMORY_PLANS)
+        : max_states(max_states_)
+        , max_plans(std::max<std::size_t>(max_plans_, 1))
+        , bounds(1024)
+        , plan_index(1024)
+    {
+    }
+
+    //! Remember that the goal is at least ticks away from s.
+    void learn_bound(const State& s, Time ticks)
+    {
+        if(ticks <= 0)
+            return;
+
+        Time* known = bounds.find(s);
+        if(known != nullptr)
+        {
+            *known = std::max(*known, ticks);
+        }
+        else if(bounds.size() < max_states)
+        {
+            bounds.insert(s, ticks);
+        }
+    }
+
+    //! Remember plan, which must be optimal from its first State.
+    void learn_plan(const BuildOrder& plan)
+    {
+        if(plan.empty())
+            return;
+
+        if(plans.size() >= max_plans)
+        {
+            forget_older_plans();
+        }
+        plans.push_back(plan);
+        for(std::size_t i = 0; i < plan.size(); ++i)
+        {
+            plans.back()[i].predecessor = nullptr;
+            learn_bound(plan[i].state, plan.back().t - plan[i].t);
+        }
+        index_plan(plans.size() - 1);
+    }
+
+    //! A lower bound on the ticks from s to the goal, 0 if none is known.
+    Time bound(const State& s) const
+    {
+        const Time* known = bounds.find(s);
+        return known != nullptr ? *known : 0;
+    }
+
+    //! If the State of observed is one a remembered plan passes through,
+    //! set plan to the rest of it, from observed on, and return true. The
+    //! State may be that after an action of the plan, at any tick, or one
+    //! the plan waits in between two actions, at the tick it does so.
+    bool continuation(const Node& observed, BuildOrder& plan) const
+    {
+        const PlanPosition* at = plan_index.find(observed.state);
+        if(at != nullptr)
+        {
+            const BuildOrder& p = plans[at->plan];
+            copy_suffix(observed, p, at->index + 1, observed.t - p[at->index].t, plan);
+            return true;
+        }
+
+        for(const BuildOrder& p : plans)
+        {
+            // The last action of the plan at or before the observed tick.
+            auto after = std::upper_bound(p.begin(), p.end(), observed.t, [](Time t, const Node& n) { return t < n.t; });
+            if(after == p.begin() || after == p.end() || (after - 1)->t == observed.t)
+                continue;
+
+            State waited = (after - 1)->state;
+            update(waited, observed.t - (after - 1)->t);
+            if(waited == observed.state)
+            {
+                copy_suffix(observed, p, after - p.begin(), 0, plan);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //! Do the actions of each remembered plan from observed, starting with
+    //! each one up to the first after the observed tick. If any of those
+    //! runs end where is_goal holds, set plan to the one that ends first
+    //! and return true. The plan need not be optimal.
+    template<typename Goal>
+    bool repair(const Node& observed, Goal is_goal, BuildOrder& plan) const
+    {
+        bool found = false;
+        BuildOrder attempt;
+        for(const BuildOrder& p : plans)
+        {
+            auto after = std::upper_bound(p.begin() + 1, p.end(), observed.t, [](Time t, const Node& n) { return t < n.t; });
+            std::size_t last = std::min<std::size_t>(after - p.begin(), p.size() - 1);
+            for(std::size_t first = 1; first <= last; ++first)
+            {
+                attempt.reserve(p.size() - first + 1);
+                attempt.assign(1, observed);
+                std::size_t i = first;
+                for(; i < p.size() && can_apply_action(attempt.back(), p[i].action.id); ++i)
+                {
+                    attempt.push_back(apply_action(attempt.back(), p[i].action.id));
+                }
+                if(i == p.size() && is_goal(attempt.back()) && (!found || attempt.back().t < plan.back().t))
+                {
+                    plan.swap(attempt);
+                    found = true;
+                }
+            }
+        }
+        if(found)
+        {
+            plan.front().predecessor = nullptr;
+            for(auto n = plan.begin() + 1; n != plan.end(); ++n)
+            {
+                n->predecessor = &*(n - 1);
+            }
+        }
+        return found;
+    }
+
+    std::size_t size() const
+    {
+        return bounds.size();
+    }
+
+    //! How many more States learn_bound() will take new bounds for.
+    std::size_t states_left() const
+    {
+        return bounds.size() < max_states ? max_states - bounds.size() : 0;
+    }
+
+    std::size_t memory_usage() const
+    {
+        std::size_t plan_nodes = 0;
+        for(const BuildOrder& p : plans)
+        {
+            plan_nodes += p.capacity();
+        }
+        return bounds.memory_usage() + plan_index.memory_usage() + plan_nodes * sizeof(Node);
+    }
+
+private:
+    struct PlanPosition
+    {
+        std::uint32_t plan;
+        std::uint32_t index;
+    };
+
+    void index_plan(std::size_t p)
+    {
+        for(std::size_t i = 0; i < plans[p].size(); ++i)
+        {
+            plan_index.insert(plans[p][i].state, PlanPosition {std::uint32_t(p), std::uint32_t(i)});
+        }
+    }
+
+    //! Keep the newer half of max_plans plans, and index them again.
+    void forget_older_plans()
+    {
+        plans.erase(plans.begin(), plans.end() - max_plans / 2);
+        plan_index.clear();
+        for(std::size_t p = 0; p < plans.size(); ++p)
+        {
+            index_plan(p);
+        }
+    }
+
+    //! Set plan to observed, then the nodes of p from first on, shifted by
+    //! shift ticks.
+    static void copy_suffix(const Node& observed, const BuildOrder& p, std::size_t first, Time shift, BuildOrder& plan)
+    {
+        plan.assign(1, observed);
+        plan.front().predecessor = nullptr;
+        plan.insert(plan.end(), p.begin() + first, p.end());
+        for(auto n = plan.begin() + 1; n != plan.end(); ++n)
+        {
+            n->t += shift;
+            n->predecessor = &*(n - 1);
+        }
+    }
+
+    std::size_t max_states;
+    std::size_t max_plans;
+    FlatHashMap<State, Time> bounds;
+    std::vector<BuildOrder> plans;
+    FlatHashMap<State, PlanPosition> plan_index;
+};
+
+#endif
@@ -0,0 +1,411 @@
+#ifndef PLANNER_SOLUTION_STORE_HPP
+#define PLANNER_SOLUTION_STORE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "problems/specification.hpp"
+
+//! What a SolutionStore knows about a problem.
+struct StoredSolution
+{
+    //! Lower bound on the ticks from the start to the goal.
+    Time lower_bound = 0;
+    //! The best plan known, from the start node of the problem, or empty.
+    BuildOrder plan;
+
+    //! Whether the plan is known to be optimal.
+    bool optimal() const
+    {
+        return !plan.empty() && plan.back().t - plan.front().t <= lower_bound;
+    }
+};
+
+//! Plans and bounds found by earlier searches, kept in a file so that they
+//! outlive the process and can be shared by several at once.
+//!
+//! Problems are told apart by the goal, the canonical start State and every
+//! game constant, written as by write_specification(); the tick the start is
+//! reached at does not matter, as nothing in the game depends on it. Plans
+//! are kept as their actions and replayed when found, so one that no longer
+//! reaches the goal in the ticks it was stored with, after a change to the
+//! game model, is ignored.
+//!
+//! The file is a header and a log of records, each appended under an
+//! exclusive lock with a checksum; it is mapped into memory and the records
+//! other processes append are indexed as they show up. A torn record left
+//! by a crash is cut off the next time the store is opened. Thread-safe.
+class SolutionStore
+{
+public:
+    //! Open the store at path, creating it if need be. Throws
+    //! std::runtime_error.
+    explicit SolutionStore(const std::string& path_)
+        : path(path_)
+        , fd(::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644))
+        , data(nullptr)
+        , mapped(0)
+        , indexed(0)
+    {
+        if(fd < 0)
+            throw error("cannot open");
+
+        ::flock(fd, LOCK_EX);
+        struct stat st;
+        if(::fstat(fd, &st) != 0)
+        {
+            ::flock(fd, LOCK_UN);
+            ::close(fd);
+            throw error("cannot read");
+        }
+        if(st.st_size == 0)
+        {
+            FileHeader header = file_header();
+            if(::pwrite(fd, &header, sizeof(header), 0) != sizeof(header))
+            {
+                ::flock(fd, LOCK_UN);
+                ::close(fd);
+                throw error("cannot write");
+            }
+        }
+
+        try
+        {
+            refresh_locked();
+        }
+        catch(...)
+        {
+            ::flock(fd, LOCK_UN);
+            unmap();
+            ::close(fd);
+            throw;
+        }
+        if(indexed < mapped)
+        {
+            // A record was torn; later ones would be appended after it
+            // and never read.
+            if(::ftruncate(fd, indexed) != 0)
+            {
+                ::flock(fd, LOCK_UN);
+                unmap();
+                ::close(fd);
+                throw error("cannot repair");
+            }
+            unmap();
+        }
+        ::flock(fd, LOCK_UN);
+    }
+
+    ~SolutionStore()
+    {
+        unmap();
+        ::close(fd);
+    }
+
+    SolutionStore(const SolutionStore&) = delete;
+    SolutionStore& operator=(const SolutionStore&) = delete;
+
+    //! If anything is known about the problem of spec, whose constants
+    //! must be those in effect, set found to it and return true.
+    bool find(const ProblemSpecification& spec, StoredSolution& found)
+    {
+        std::string key = store_key(spec);
+        std::lock_guard<std::mutex> lock(mutex);
+        refresh();
+
+        const Entry* entry = lookup(key);
+        if(entry == nullptr)
+            return false;
+
+        found = StoredSolution();
+        found.lower_bound = entry->lower_bound;
+        if(entry->plan_record != NO_RECORD)
+        {
+            const RecordHeader& r = record_at(entry->plan_record);
+            const ActionId* actions = reinterpret_cast<const ActionId*>(data + entry->plan_record + sizeof(RecordHeader) + r.key_size);
+            BuildOrderProblem problem = spec.problem();
+            Node start = problem.start_node();
+            BuildOrder plan = replay_solution(start, std::vector<ActionId>(actions, actions + r.action_count));
+            if(plan.back().t - start.t == r.plan_ticks && problem.is_goal(plan.back()))
+            {
+                found.plan = std::move(plan);
+            }
+        }
+        return true;
+    }
+
+    //! Remember that no plan for the problem of spec takes less than
+    //! lower_bound ticks, and plan if not null. Nothing is written unless
+    //! it improves on what is known.
+    void record(const ProblemSpecification& spec, Time lower_bound, const BuildOrder* plan)
+    {
+        std::string key = store_key(spec);
+        Time plan_ticks = plan != nullptr && !plan->empty() ? plan->back().t - plan->front().t : NO_PLAN;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        refresh();
+        const Entry* known = lookup(key);
+        if(known != nullptr)
+        {
+            bool better_bound = lower_bound > known->lower_bound;
+            bool better_plan = plan_ticks != NO_PLAN && (known->plan_record == NO_RECORD || plan_ticks < known->plan_ticks);
+            if(!better_bound && !better_plan)
+                return;
+        }
+        if(lower_bound <= 0 && plan_ticks == NO_PLAN)
+            return;
+
+        std::vector<ActionId> actions;
+        if(plan_ticks != NO_PLAN)
+        {
+            for(auto n = plan->begin() + 1; n != plan->end(); ++n)
+            {
+                actions.push_back(n->action.id);
+            }
+        }
+
+        RecordHeader r;
+        r.magic = RECORD_MAGIC;
+        r.key_size = key.size();
+        r.action_count = actions.size();
+        r.lower_bound = lower_bound;
+        r.plan_ticks = plan_ticks;
+        std::string bytes(padded(sizeof(RecordHeader) + key.size() + actions.size()), '\0');
+        std::memcpy(&bytes[sizeof(RecordHeader)], key.data(), key.size());
+        if(!actions.empty())
+        {
+            std::memcpy(&bytes[sizeof(RecordHeader) + key.size()], actions.data(), actions.size());
+        }
+        r.checksum = checksum(bytes.data() + sizeof(RecordHeader), bytes.size() - sizeof(RecordHeader));
+        std::memcpy(&bytes[0], &r, sizeof(r));
+
+        ::flock(fd, LOCK_EX);
+        struct stat st;
+        bool written = ::fstat(fd, &st) == 0 &&
+                       ::pwrite(fd, bytes.data(), bytes.size(), st.st_size) == ssize_t(bytes.size());
+        ::flock(fd, LOCK_UN);
+        if(!written)
+            throw error("cannot write");
+        refresh();
+    }
+
+    //! How many problems something is known about.
+    std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        refresh();
+        return index.size();
+    }
+
+private:
+    struct FileHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t record_alignment;
+    };
+
+    struct RecordHeader
+    {
+        std::uint32_t magic;
+        std::uint32_t checksum;
+        std::uint32_t key_size;
+        std::uint32_t action_count;
+        std::int32_t lower_bound;
+        std::int32_t plan_ticks;
+    };
+
+    //! The best of the records for one problem, by offset in the file.
+    struct Entry
+    {
+        std::size_t key_record;
+        Time lower_bound;
+        std::size_t plan_record;
+        Time plan_ticks;
+    };
+
+    static constexpr std::uint32_t FORMAT_VERSION = 1;
+    static constexpr std::uint32_t RECORD_MAGIC = 0x53524142;
+    static constexpr std::size_t ALIGNMENT = 8;
+    static constexpr std::size_t NO_RECORD = SIZE_MAX;
+    static constexpr Time NO_PLAN = -1;
+
+    static FileHeader file_header()
+    {
+        FileHeader h;
+        std::memcpy(h.magic, "baryonss", sizeof(h.magic));
+        h.version = FORMAT_VERSION;
+        h.record_alignment = ALIGNMENT;
+        return h;
+    }
+
+    static std::size_t padded(std::size_t size)
+    {
+        return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    //! FNV-1a.
+    static std::uint64_t fnv1a(const char* p, std::size_t size)
+    {
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    static std::uint32_t checksum(const char* p, std::size_t size)
+    {
+        std::uint64_t h = fnv1a(p, size);
+        return std::uint32_t(h ^ (h >> 32));
+    }
+
+    //! The problem of spec, from its canonical start at tick 0.
+    static std::string store_key(ProblemSpecification spec)
+    {
+        spec.start_time = 0;
+        canonicalize(spec.start);
+        std::ostringstream os;
+        write_specification(os, spec);
+        return os.str();
+    }
+
+    std::runtime_error error(const std::string& what) const
+    {
+        return std::runtime_error(what + " solution store " + path + ": " + std::strerror(errno));
+    }
+
+    const RecordHeader& record_at(std::size_t offset) const
+    {
+        return *reinterpret_cast<const RecordHeader*>(data + offset);
+    }
+
+    const Entry* lookup(const std::string& key) const
+    {
+        auto found = index.find(fnv1a(key.data(), key.size()));
+        if(found == index.end())
+            return nullptr;
+        const RecordHeader& r = record_at(found->second.key_record);
+        const char* stored = data + found->second.key_record + sizeof(RecordHeader);
+        if(r.key_size != key.size() || std::memcmp(stored, key.data(), key.size()) != 0)
+            return nullptr;
+        return &found->second;
+    }
+
+    void unmap()
+    {
+        if(data != nullptr)
+        {
+            ::munmap(const_cast<char*>(data), mapped);
+        }
+        data = nullptr;
+        mapped = 0;
+    }
+
+    //! Index the records appended since the last call, under a shared lock
+    //! so that none is caught half written.
+    void refresh()
+    {
+        ::flock(fd, LOCK_SH);
+        try
+        {
+            refresh_locked();
+        }
+        catch(...)
+        {
+            ::flock(fd, LOCK_UN);
+            throw;
+        }
+        ::flock(fd, LOCK_UN);
+    }
+
+    void refresh_locked()
+    {
+        struct stat st;
+        if(::fstat(fd, &st) != 0)
+            throw error("cannot read");
+        std::size_t size = st.st_size;
+        if(size == mapped)
+            return;
+
+        unmap();
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(p == MAP_FAILED)
+            throw error("cannot map");
+        data = static_cast<const char*>(p);
+        mapped = size;
+
+        if(indexed == 0)
+        {
+            FileHeader expected = file_header();
+            if(size < sizeof(FileHeader) || std::memcmp(data, &expected, sizeof(FileHeader)) != 0)
+            {
+                throw std::runtime_error("not a solution store of this version: " + path);
+            }
+            indexed = sizeof(FileHeader);
+        }
+
+        while(indexed + sizeof(RecordHeader) <= size)
+        {
+            const RecordHeader& r = record_at(indexed);
+            std::size_t record_size = padded(sizeof(RecordHeader) + std::size_t(r.key_size) + r.action_count);
+            if(r.magic != RECORD_MAGIC || record_size > size - indexed ||
+               checksum(data + indexed + sizeof(RecordHeader), record_size - sizeof(RecordHeader)) != r.checksum)
+                break;
+
+            learn_record(indexed);
+            indexed += record_size;
+        }
+    }
+
+    void learn_record(std::size_t offset)
+    {
+        const RecordHeader& r = record_at(offset);
+        std::uint64_t h = fnv1a(data + offset + sizeof(RecordHeader), r.key_size);
+        auto inserted = index.emplace(h, Entry {offset, 0, NO_RECORD, NO_PLAN});
+        Entry& e = inserted.first->second;
+        const RecordHeader& first = record_at(e.key_record);
+        if(!inserted.second && (first.key_size != r.key_size ||
+                                std::memcmp(data + e.key_record + sizeof(RecordHeader), data + offset + sizeof(RecordHeader), r.key_size) != 0))
+        {
+            // Another problem with the same hash; the first one keeps it.
+            return;
+        }
+
+        e.lower_bound = std::max<Time>(e.lower_bound, r.lower_bound);
+        if(r.plan_ticks != NO_PLAN && (e.plan_record == NO_RECORD || r.plan_ticks < e.plan_ticks))
+        {
+            e.plan_record = offset;
+            e.plan_ticks = r.plan_ticks;
+        }
+    }
+
+    std::string path;
+    int fd;
+    const char* data;
+    std::size_t mapped;
+    std::size_t indexed;
+    std::unordered_map<std::uint64_t, Entry> index;
+    std::mutex mutex;
+};
+
+#endif
@@ -0,0 +1,510 @@
+#ifndef PLANNER_SPECIFICATION_HPP
+#define PLANNER_SPECIFICATION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/constants.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "problems/buildorder.hpp"
+
+//! Everything about a planning problem that is not up to the solver: the
+//! game constants, the State the plan starts from and its goal.
+//!
+//! A specification is written as lines of key = value, with # starting a
+//! comment. The keys are those written by write_specification():
+//!
+//! - goal.zps: how many ZPs must be upgraded or being upgraded.
+//! - start.time: the tick the start State is reached at, so that a plan can
+//!   continue a game in progress.
+//! - start.lc, start.qp, start.annexes, ...: the counts of the start State.
+//! - start.lc_rps, start.qp_rps: one timer per RP, separated by spaces; ticks
+//!   into its current cycle, negative while it is still being built or
+//!   switched.
+//! - start.zv_queue, ...: one entry per unit in production, the ticks until
+//!   it is done.
+//! - the fields of GameConstants, e.g. lc_cycle_length; fixed_rp_timings =
+//!   true sets the RP cycle lengths to the intended ones.
+struct ProblemSpecification
+{
+    GameConstants constants;
+    State start;
+    Time start_time = 0;
+    unsigned goal_zps = NUM_ZPS;
+
+    //! Make the constants of this specification the ones all searches use;
+    //! see game.
+    void apply_constants() const
+    {
+        game = constants;
+    }
+
+    BuildOrderProblem problem() const
+    {
+        return BuildOrderProblem(goal_zps, start, start_time);
+    }
+
+    //! The problem, sharing cache with other problems of the same constants.
+    BuildOrderProblem problem(std::shared_ptr<GatherCache> cache) const
+    {
+        return BuildOrderProblem(goal_zps, start, start_time, std::move(cache));
+    }
+};
+
+//! One of the problems of a batch; see read_batch().
+struct BatchInstance
+{
+    std::string name;
+    ProblemSpecification spec;
+};
+
+namespace specification_detail {
+
+template<typename T>
+struct Field
+{
+    const char* key;
+    T GameConstants::* member;
+};
+
+const Field<Time> TIME_CONSTANTS[] = {
+    {"lc_cycle_length", &GameConstants::lc_cycle_length},
+    {"qp_cycle_length", &GameConstants::qp_cycle_length},
+    {"rp_switch_time", &GameConstants::rp_switch_time},
+    {"rp_build_time", &GameConstants::rp_build_time},
+    {"foundation_build_time", &GameConstants::foundation_build_time},
+    {"depot_build_time", &GameConstants::depot_build_time},
+    {"zv_build_time", &GameConstants::zv_build_time},
+    {"zp_build_time", &GameConstants::zp_build_time},
+    {"skip_upgrade_time", &GameConstants::skip_upgrade_time},
+};
+
+const Field<Resource> RESOURCE_CONSTANTS[] = {
+    {"lc_yield_size", &GameConstants::lc_yield_size},
+    {"qp_yield_size", &GameConstants::qp_yield_size},
+    {"rp_lc_cost", &GameConstants::rp_lc_cost},
+    {"foundation_lc_cost", &GameConstants::foundation_lc_cost},
+    {"depot_lc_cost", &GameConstants::depot_lc_cost},
+    {"depot_qp_cost", &GameConstants::depot_qp_cost},
+    {"zv_lc_cost", &GameConstants::zv_lc_cost},
+    {"zp_lc_cost", &GameConstants::zp_lc_cost},
+    {"zp_qp_cost", &GameConstants::zp_qp_cost},
+    {"skip_upgrade_lc_cost", &GameConstants::skip_upgrade_lc_cost},
+    {"skip_upgrade_qp_cost", &GameConstants::skip_upgrade_qp_cost},
+};
+
+const struct
+{
+    const char* key;
+    Resource State::* member;
+} STATE_RESOURCES[] = {
+    {"start.lc", &State::lc},
+    {"start.qp", &State::qp},
+};
+
+const struct
+{
+    const char* key;
+    Count State::* member;
+} STATE_COUNTS[] = {
+    {"start.annexes", &State::annexes},
+    {"start.depots", &State::depots},
+    {"start.foundations", &State::foundations},
+    {"start.zvs", &State::zvs},
+    {"start.zps", &State::zps},
+    {"start.upgraded_zps", &State::upgraded_zps},
+};
+
+const struct
+{
+    const char* key;
+    RPState State::* member;
+} STATE_RPS[] = {
+    {"start.lc_rps", &State::lc_rp_state},
+    {"start.qp_rps", &State::qp_rp_state},
+};
+
+inline long parse_integer(const std::string& key, const std::string& value, long min, long max)
+{
+    const char* begin = value.c_str();
+    char* end;
+    long x = std::strtol(begin, &end, 10);
+    if(end == begin || *end != '\0' || x < min || x > max)
+        throw std::runtime_error(key + ": expected an integer from " + std::to_string(min) + " to " + std::to_string(max) + ", got '" + value + "'");
+    return x;
+}
+
+inline bool parse_bool(const std::string& key, const std::string& value)
+{
+    if(value == "true" || value == "1")
+        return true;
+    if(value == "false" || value == "0")
+        return false;
+    throw std::runtime_error(key + ": expected true or false, got '" + value + "'");
+}
+
+//! Parse a list of timers, each of them negated if negate is set.
+template<std::size_t N>
+FixedVector<Timer, N> parse_timers(const std::string& key, const std::string& value, bool negate)
+{
+    FixedVector<Timer, N> timers;
+    std::istringstream is(value);
+    std::string word;
+    while(is >> word)
+    {
+        if(timers.full())
+            throw std::runtime_error(key + ": at most " + std::to_string(N) + " entries");
+        Timer t = parse_integer(key, word, negate ? 1 : std::numeric_limits<Timer>::min(), std::numeric_limits<Timer>::max());
+        timers.push_back(negate ? -t : t);
+    }
+    return timers;
+}
+
+inline std::string trim(const std::string& s)
+{
+    std::size_t begin = s.find_first_not_of(" \t\r");
+    if(begin == std::string::npos)
+        return std::string();
+    return s.substr(begin, s.find_last_not_of(" \t\r") + 1 - begin);
+}
+
+//! Split a line of a specification into key and value, returning false if
+//! it is empty or a comment. Throws std::runtime_error if it is malformed.
+inline bool split_line(std::string line, std::string& key, std::string& value)
+{
+    line = trim(line.substr(0, line.find('#')));
+    if(line.empty())
+        return false;
+
+    std::size_t eq = line.find('=');
+    if(eq == std::string::npos)
+        throw std::runtime_error("expected key = value");
+    key = trim(line.substr(0, eq));
+    value = trim(line.substr(eq + 1));
+    return true;
+}
+
+inline std::runtime_error line_error(unsigned number, const std::exception& e)
+{
+    return std::runtime_error("line " + std::to_string(number) + ": " + e.what());
+}
+
+//! Set queue from value and return true if key is name.
+template<std::size_t N>
+bool set_queue(const std::string& key, const std::string& value, const char* name, ProductionState<N>& queue)
+{
+    if(key != name)
+        return false;
+    queue = parse_timers<N>(key, value, true);
+    return true;
+}
+
+template<std::size_t N>
+void write_timers(std::ostream& os, const char* key, const FixedVector<Timer, N>& timers, bool negate)
+{
+    os << key << " =";
+    for(Timer t : timers)
+    {
+        os << ' ' << (negate ? -t : t);
+    }
+    os << '\n';
+}
+
+}
+
+//! Set one entry of spec. Throws std::runtime_error for unknown keys and
+//! malformed values; check_specification() does the remaining checks.
+void set_specification_value(ProblemSpecification& spec, const std::string& key, const std::string& value)
+{
+    using namespace specification_detail;
+
+    const long TIME_MAX = std::numeric_limits<Timer>::max();
+    const long RESOURCE_MAX = std::numeric_limits<Resource>::max() / 2;
+
+    if(key == "goal.zps")
+    {
+        spec.goal_zps = parse_integer(key, value, 1, MAX_GOAL_ZPS);
+        return;
+    }
+    if(key == "start.time")
+    {
+        spec.start_time = parse_integer(key, value, 0, std::numeric_limits<Time>::max() / 2);
+        return;
+    }
+    if(key == "fixed_rp_timings")
+    {
+        if(parse_bool(key, value))
+        {
+            spec.constants.use_fixed_rp_timings();
+        }
+        else
+        {
+            GameConstants defaults;
+            spec.constants.lc_cycle_length = defaults.lc_cycle_length;
+            spec.constants.qp_cycle_length = defaults.qp_cycle_length;
+        }
+        return;
+    }
+    for(const auto& f : TIME_CONSTANTS)
+    {
+        if(key == f.key)
+        {
+            spec.constants.*f.member = parse_integer(key, value, 0, TIME_MAX);
+            return;
+        }
+    }
+    for(const auto& f : RESOURCE_CONSTANTS)
+    {
+        if(key == f.key)
+        {
+            spec.constants.*f.member = parse_integer(key, value, 0, RESOURCE_MAX);
+            return;
+        }
+    }
+    for(const auto& f : STATE_RESOURCES)
+    {
+        if(key == f.key)
+        {
+            spec.start.*f.member = parse_integer(key, value, 0, RESOURCE_MAX);
+            return;
+        }
+    }
+    for(const auto& f : STATE_COUNTS)
+    {
+        if(key == f.key)
+        {
+            spec.start.*f.member = parse_integer(key, value, 0, std::numeric_limits<Count>::max());
+            return;
+        }
+    }
+    for(const auto& f : STATE_RPS)
+    {
+        if(key == f.key)
+        {
+            spec.start.*f.member = parse_timers<MAX_RPS>(key, value, false);
+            return;
+        }
+    }
+    State& s = spec.start;
+    if(set_queue(key, value, "start.foundation_queue", s.foundation_queue) ||
+       set_queue(key, value, "start.depot_queue", s.depot_queue) ||
+       set_queue(key, value, "start.zv_queue", s.zv_queue) ||
+       set_queue(key, value, "start.zp_queue", s.zp_queue) ||
+       set_queue(key, value, "start.zp_upgrade_queue", s.zp_upgrade_queue))
+    {
+        return;
+    }
+    throw std::runtime_error("unknown key '" + key + "'");
+}
+
+//! Set spec from the key = value lines of is. Keys not given keep their
+//! value. Errors name the line they are on.
+void read_specification(std::istream& is, ProblemSpecification& spec)
+{
+    using namespace specification_detail;
+
+    std::string line, key, value;
+    for(unsigned number = 1; std::getline(is, line); ++number)
+    {
+        try
+        {
+            if(split_line(line, key, value))
+            {
+                set_specification_value(spec, key, value);
+            }
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw line_error(number, e);
+        }
+    }
+}
+
+//! Throw std::runtime_error unless the constants and the start State of
+//! spec make sense together.
+void check_specification(const ProblemSpecification& spec)
+{
+    const GameConstants& c = spec.constants;
+    if(c.lc_cycle_length <= 0 || c.qp_cycle_length <= 0)
+        throw std::runtime_error("RP cycle lengths must be positive");
+    if(c.lc_yield_size == 0 || c.qp_yield_size == 0)
+        throw std::runtime_error("RP yield sizes must be positive");
+    if(c.zp_build_time < c.zv_build_time)
+        throw std::runtime_error("zp_build_time must be at least zv_build_time");
+    // Production takes time, or the search would advance by zero ticks.
+    for(const auto& f : specification_detail::TIME_CONSTANTS)
+    {
+        if(f.member != &GameConstants::rp_switch_time && c.*f.member <= 0)
+            throw std::runtime_error(std::string(f.key) + " must be positive");
+    }
+
+    const State& s = spec.start;
+    if(s.lc_rp_state.size() + s.qp_rp_state.size() > MAX_RPS)
+        throw std::runtime_error("at most " + std::to_string(MAX_RPS) + " RPs");
+    // The queues of State hold no more than these allow.
+    if(s.annexes > MAX_QUEUED_ZVS)
+        throw std::runtime_error("start.annexes: at most " + std::to_string(MAX_QUEUED_ZVS));
+    if(s.depots > MAX_QUEUED_ZPS / PULSERS_PER_DEPOT)
+        throw std::runtime_error("start.depots: at most " + std::to_string(MAX_QUEUED_ZPS / PULSERS_PER_DEPOT));
+    if(s.zv_queue.size() > s.annexes)
+        throw std::runtime_error("start.zv_queue: at most one ZV per annex");
+    if(s.zp_queue.size() > PULSERS_PER_DEPOT * s.depots)
+        throw std::runtime_error("start.zp_queue: at most " + std::to_string(PULSERS_PER_DEPOT) + " ZPs per depot");
+    for(Timer t : s.lc_rp_state)
+    {
+        if(t >= c.lc_cycle_length)
+            throw std::runtime_error("start.lc_rps: timers must be below lc_cycle_length");
+    }
+    for(Timer t : s.qp_rp_state)
+    {
+        if(t >= c.qp_cycle_length)
+            throw std::runtime_error("start.qp_rps: timers must be below qp_cycle_length");
+    }
+
+    // The goal must be within reach, or a search would never end. ZPs come
+    // from annexes or from the ZVs there are. With an RP, or the means to
+    // build one, any cost can be paid in time; without, only from stock.
+    std::uint64_t started = s.zp_upgrade_queue.size() + s.upgraded_zps;
+    std::uint64_t zps = started + s.zp_queue.size() + s.zps;
+    std::uint64_t zvs = s.zv_queue.size() + s.zvs;
+    std::uint64_t upgrades = spec.goal_zps > started ? spec.goal_zps - started : 0;
+    std::uint64_t needed = spec.goal_zps > zps ? spec.goal_zps - zps : 0;
+    if(s.annexes == 0 && zvs < needed)
+        throw std::runtime_error("the goal cannot be reached: too few ZVs and no annex to build more");
+
+    bool income = !s.lc_rp_state.empty() || !s.qp_rp_state.empty() ||
+                  (zvs >= 1 && s.lc >= c.rp_lc_cost) ||
+                  (s.annexes >= 1 && s.lc >= std::uint64_t(c.zv_lc_cost) + c.rp_lc_cost);
+    if(!income)
+    {
+        std::uint64_t pilots = std::min(needed, zvs);
+        std::uint64_t lc = upgrades * c.skip_upgrade_lc_cost + needed * c.zp_lc_cost + (needed - pilots) * c.zv_lc_cost;
+        std::uint64_t qp = upgrades * c.skip_upgrade_qp_cost + needed * c.zp_qp_cost;
+        if(needed > 0 && s.depots == 0 && s.depot_queue.empty())
+        {
+            lc += c.depot_lc_cost;
+            qp += c.depot_qp_cost;
+            if(s.foundations == 0 && s.foundation_queue.empty())
+            {
+                lc += c.foundation_lc_cost;
+            }
+        }
+        if(s.lc < lc || s.qp < qp)
+            throw std::runtime_error("the goal cannot be reached: no RPs, and too little LC or QP to pay for it");
+    }
+}
+
+//! Read a batch of problems. A line [name] starts the specification of a
+//! problem called name; the lines before the first of them apply to every
+//! problem, on top of base. Each problem is checked with
+//! check_specification(). Throws std::runtime_error.
+std::vector<BatchInstance> read_batch(std::istream& is, ProblemSpecification base)
+{
+    using namespace specification_detail;
+
+    std::vector<BatchInstance> instances;
+    std::string line, key, value;
+    for(unsigned number = 1; std::getline(is, line); ++number)
+    {
+        try
+        {
+            std::string header = trim(line.substr(0, line.find('#')));
+            if(!header.empty() && header.front() == '[')
+            {
+                std::string name = trim(header.substr(1, header.size() - 2));
+                if(header.back() != ']' || name.empty())
+                    throw std::runtime_error("expected [name]");
+                instances.push_back(BatchInstance {name, base});
+            }
+            else if(split_line(line, key, value))
+            {
+                set_specification_value(instances.empty() ? base : instances.back().spec, key, value);
+            }
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw line_error(number, e);
+        }
+    }
+
+    if(instances.empty())
+        throw std::runtime_error("no [name] sections, so no problems to solve");
+    for(const BatchInstance& instance : instances)
+    {
+        try
+        {
+            check_specification(instance.spec);
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw std::runtime_error(instance.name + ": " + e.what());
+        }
+    }
+    return instances;
+}
+
+//! Whether a and b have the same value for every constant.
+bool same_constants(const GameConstants& a, const GameConstants& b)
+{
+    using namespace specification_detail;
+
+    for(const auto& f : TIME_CONSTANTS)
+    {
+        if(a.*f.member != b.*f.member)
+            return false;
+    }
+    for(const auto& f : RESOURCE_CONSTANTS)
+    {
+        if(a.*f.member != b.*f.member)
+            return false;
+    }
+    return true;
+}
+
+//! Write every entry of spec, in the format read_specification() reads.
+void write_specification(std::ostream& os, const ProblemSpecification& spec)
+{
+    using namespace specification_detail;
+
+    os << "goal.zps = " << spec.goal_zps << '\n';
+    os << "start.time = " << spec.start_time << '\n';
+    for(const auto& f : STATE_RESOURCES)
+    {
+        os << f.key << " = " << spec.start.*f.member << '\n';
+    }
+    for(const auto& f : STATE_COUNTS)
+    {
+        os << f.key << " = " << spec.start.*f.member << '\n';
+    }
+    for(const auto& f : STATE_RPS)
+    {
+        write_timers(os, f.key, spec.start.*f.member, false);
+    }
+    write_timers(os, "start.foundation_queue", spec.start.foundation_queue, true);
+    write_timers(os, "start.depot_queue", spec.start.depot_queue, true);
+    write_timers(os, "start.zv_queue", spec.start.zv_queue, true);
+    write_timers(os, "start.zp_queue", spec.start.zp_queue, true);
+    write_timers(os, "start.zp_upgrade_queue", spec.start.zp_upgrade_queue, true);
+    for(const auto& f : TIME_CONSTANTS)
+    {
+        os << f.key << " = " << spec.constants.*f.member << '\n';
+    }
+    for(const auto& f : RESOURCE_CONSTANTS)
+    {
+        os << f.key << " = " << spec.constants.*f.member << '\n';
+    }
+}
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef PLANNER_PLANNER_SERVICE_HPP
+#define PLANNER_PLANNER_SERVICE_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "problems/buildorder.hpp"
+#include "problems/specification.hpp"
+#include "solvers/batch.hpp"
+#include "solvers/dispatch.hpp"
+#include "solvers/replanner.hpp"
+#include "solvers/stop_token.hpp"
+
+//! Heuristic caches and search memories kept across requests, one per set
+//! of game constants, for the most recently used sets.
+constexpr std::size_t SERVICE_CACHED_CONSTANTS = 4;
+
+//! A problem sent to the service, with the solver to use on it and its own
+//! time limit.
+struct ServiceRequest
+{
+    std::string name;
+    ProblemSpecification spec;
+    SolverKind solver = SolverKind::ASTAR;
+    double time_limit = 0;
+};
+
+//! Parse a request from its lines, which are those of a specification plus
+//! solver = NAME and time_limit = SECONDS, on top of what request holds.
+//! Throws std::runtime_error.
+void parse_request(const std::vector<std::string>& lines, ServiceRequest& request)
+{
+    std::string key, value;
+    for(std::size_t i = 0; i < lines.size(); ++i)
+    {
+        try
+        {
+            if(!specification_detail::split_line(lines[i], key, value))
+                continue;
+
+            if(key == "solver")
+            {
+                request.solver = parse_solver_kind(value);
+            }
+            else if(key == "time_limit")
+            {
+                char* end;
+                request.time_limit = std::strtod(value.c_str(), &end);
+                if(end == value.c_str() || *end != '\0' || !(request.time_limit >= 0))
+                    throw std::runtime_error("time_limit: expected a non-negative number, got '" + value + "'");
+            }
+            else
+            {
+                set_specification_value(request.spec, key, value);
+            }
+        }
+        catch(const std::runtime_error& e)
+        {
+            throw specification_detail::line_error(i + 1, e);
+        }
+    }
+    check_specification(request.spec);
+}
+
+//! Read the next request from next_line, which sets its argument to the
+//! next line and returns false at the end of the input. A request is a line
+//! [name], the lines parse_request() takes, and an empty line or the end of
+//! the input. Lines before the [name] line are skipped.
+//!
+//! Returns false at the end of the input. A malformed request is still
+//! read to its end, and returned with error set instead of being parsed.
+bool read_request(const std::function<bool(std::string&)>& next_line, const ServiceRequest& defaults, ServiceRequest& request, std::string& error)
+{
+    std::string line;
+    std::string header;
+    do
+    {
+        if(!next_line(line))
+            return false;
+        header = specification_detail::trim(line);
+    }
+    while(header.empty());
+
+    request = defaults;
+    error.clear();
+    if(header.front() != '[' || header.back() != ']' || header.size() < 3)
+    {
+        request.name = header;
+        error = "expected [name] to start a request";
+    }
+    else
+    {
+        request.name = specification_detail::trim(header.substr(1, header.size() - 2));
+    }
+
+    std::vector<std::string> lines;
+    while(next_line(line) && !specification_detail::trim(line).empty())
+    {
+        lines.push_back(line);
+    }
+
+    if(error.empty())
+    {
+        try
+        {
+            parse_request(lines, request);
+        }
+        catch(const std::runtime_error& e)
+        {
+            error = e.what();
+        }
+    }
+    return true;
+}
+
+//! Solves requests as they come, with a fixed number of worker threads,
+//! and keeps the heuristic caches of recent requests warm for the next
+//! ones. Each answer is a line of JSON, as in batch mode, passed to the
+//! Responder given with its request.
+//!
+//! Requests are replanned as by replan_specification(), with a
+//! SearchMemory per goal and set of constants, so a request for a game
+//! further along a plan sent before is answered without a search. What a
+//! search proves is learned once no request reads that memory.
+//!
+//! The game constants are global, so requests start in the order they were
+//! submitted, and one whose constants differ from those of the requests
+//! being solved waits until they are done.
+class PlannerService
+{
+public:
+    typedef std::function<void(const std::string&)> Responder;
+
+    //! Solve up to jobs requests at once, with the solver options given;
+    //! each request chooses its own solver and time limit.
+    PlannerService(const SolverOptions& options_, unsigned jobs)
+        : options(options_)
+        , running(0)
+        , submitted(0)
+        , stopping(false)
+    {
+        options.report_stream = nullptr;
+        options.on_improvement = nullptr;
+        for(unsigned i = 0; i < std::max(jobs, 1u); ++i)
+        {
+            workers.emplace_back(&PlannerService::work, this);
+        }
+    }
+
+    ~PlannerService()
+    {
+        stop();
+    }
+
+    PlannerService(const PlannerService&) = delete;
+    PlannerService& operator=(const PlannerService&) = delete;
+
+    //! Queue request; respond is called from a worker thread with the
+    //! answer, or with the error if it is not empty.
+    void submit(const ServiceRequest& request, const std::string& error, Responder respond)
+    {
+        std::ostringstream os;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::size_t index = submitted++;
+            if(error.empty() && !stopping)
+            {
+                queue.push_back(Job {request, std::move(respond), index});
+                changed.notify_all();
+                return;
+            }
+            write_error_json(os, request.name, index, stopping ? "the service is stopping" : error);
+        }
+        // Answering may block, and must not hold up the workers.
+        respond(os.str());
+    }
+
+    //! Wait until every request submitted so far has been answered.
+    void wait_idle()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this]() { return queue.empty() && running == 0; });
+    }
+
+    //! Stop the requests being solved, drop the queued ones and end the
+    //! workers.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            queue.clear();
+            changed.notify_all();
+        }
+        cancel.cancel();
+        for(std::thread& t : workers)
+        {
+            t.join();
+        }
+        workers.clear();
+    }
+
+private:
+    struct Job
+    {
+        ServiceRequest request;
+        Responder respond;
+        std::size_t index;
+    };
+
+    //! Whether the next job may start: when nothing is running, it may
+    //! change the constants.
+    bool can_start() const
+    {
+        return !queue.empty() && (running == 0 || same_constants(queue.front().request.spec.constants, game));
+    }
+
+    //! A SearchMemory with the lessons of the requests that finished while
+    //! others still read it. The last reader to finish teaches them to it,
+    //! outside the lock; no request reads it meanwhile.
+    struct Learning
+    {
+        SearchMemory memory;
+        unsigned readers = 0;
+        bool teaching = false;
+        SearchLessons pending;
+    };
+
+    struct CachedConstants
+    {
+        GameConstants constants;
+        std::shared_ptr<GatherCache> cache;
+        std::map<unsigned, std::shared_ptr<Learning>> learning;
+    };
+
+    //! What is kept for the constants in effect, most recently used first.
+    CachedConstants& cached_for_constants()
+    {
+        auto same = [](const CachedConstants& c) { return same_constants(c.constants, game); };
+        auto found = std::find_if(caches.begin(), caches.end(), same);
+        if(found == caches.end())
+        {
+            if(caches.size() == SERVICE_CACHED_CONSTANTS)
+            {
+                caches.pop_back();
+            }
+            caches.push_front(CachedConstants {game, std::make_shared<GatherCache>(), {}});
+        }
+        else
+        {
+            std::rotate(caches.begin(), found, found + 1);
+        }
+        return caches.front();
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            changed.wait(lock, [this]() { return stopping || can_start(); });
+            if(stopping)
+                return;
+
+            Job job = std::move(queue.front());
+            queue.pop_front();
+            if(running == 0)
+            {
+                // No search is running, so the constants can change.
+                job.request.spec.apply_constants();
+            }
+            ++running;
+            CachedConstants& cached = cached_for_constants();
+            std::shared_ptr<GatherCache> cache = cached.cache;
+            std::shared_ptr<Learning>& entry = cached.learning[job.request.spec.goal_zps];
+            if(!entry)
+            {
+                entry = std::make_shared<Learning>();
+            }
+            std::shared_ptr<Learning> learning = entry;
+            changed.wait(lock, [&learning]() { return !learning->teaching; });
+            ++learning->readers;
+            lock.unlock();
+
+            SolverOptions job_options = options;
+            job_options.kind = job.request.solver;
+            SearchLessons lessons;
+            SolveResult r = replan_specification(job.request.spec, job_options, cache, learning->memory, job.request.time_limit, &cancel, lessons);
+            std::ostringstream os;
+            write_result_json(os, job.request.name, job.index, job.request.solver, job.request.spec.goal_zps, r);
+            job.respond(os.str());
+
+            lock.lock();
+            // The memory cannot take more bounds than it has room for, so
+            // neither does what waits for it.
+            learning->pending.max_bounds = learning->memory.states_left();
+            learning->pending.merge(lessons);
+            if(--learning->readers == 0)
+            {
+                SearchLessons taught;
+                std::swap(taught, learning->pending);
+                learning->teaching = true;
+                lock.unlock();
+                taught.teach(learning->memory);
+                lock.lock();
+                learning->teaching = false;
+            }
+            --running;
+            changed.notify_all();
+        }
+    }
+
+    SolverOptions options;
+    StopToken cancel;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Job> queue;
+    unsigned running;
+    std::size_t submitted;
+    bool stopping;
+    std::deque<CachedConstants> caches;
+    std::vector<std::thread> workers;
+};
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef PLANNER_UNIX_SOCKET_HPP
+#define PLANNER_UNIX_SOCKET_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "service/planner_service.hpp"
+
+//! How often the server checks whether it should quit, in milliseconds.
+constexpr int SOCKET_POLL_MILLISECONDS = 200;
+
+//! How long the server waits for a client to take an answer before it
+//! gives up on that client, in seconds.
+constexpr int SOCKET_SEND_TIMEOUT_SECONDS = 10;
+
+inline std::runtime_error socket_error(const std::string& what, const std::string& path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+//! Reads a file descriptor line by line.
+class FdLineReader
+{
+public:
+    explicit FdLineReader(int fd_)
+        : fd(fd_)
+        , begin(0)
+    {
+    }
+
+    //! Set line to the next line, without its newline. Returns false at
+    //! the end of the input.
+    bool next_line(std::string& line)
+    {
+        while(true)
+        {
+            std::size_t newline = buffer.find('\n', begin);
+            if(newline != std::string::npos)
+            {
+                line.assign(buffer, begin, newline - begin);
+                begin = newline + 1;
+                return true;
+            }
+
+            buffer.erase(0, begin);
+            begin = 0;
+            char chunk[4096];
+            ssize_t n = ::read(fd, chunk, sizeof(chunk));
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+            {
+                // A last line without a newline still counts.
+                line.swap(buffer);
+                buffer.clear();
+                return !line.empty();
+            }
+            buffer.append(chunk, n);
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    std::size_t begin;
+};
+
+//! Write all of s to fd, returning false if the other end is gone or, with
+//! a send timeout on fd, does not take it in time.
+inline bool write_all(int fd, const std::string& s)
+{
+    for(std::size_t done = 0; done < s.size();)
+    {
+        ssize_t n = ::send(fd, s.data() + done, s.size() - done, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+}
+
+inline sockaddr_un unix_address(const std::string& path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("socket path too long: " + path);
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+//! Connect to the Unix domain socket at path. Throws std::runtime_error.
+inline int connect_unix_socket(const std::string& path)
+{
+    sockaddr_un address = unix_address(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        throw socket_error("cannot create socket for", path);
+    if(::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::runtime_error e = socket_error("cannot connect to", path);
+        ::close(fd);
+        throw e;
+    }
+    return fd;
+}
+
+//! Answer the requests of every client of the Unix domain socket at path
+//! with service, until quit becomes non-zero, e.g. from a signal handler.
+//! Requests are read as by read_request() on top of defaults, and each
+//! answer is written back to its client as a line once it is solved, so
+//! answers come in the order they finish. A client may send many requests
+//! and should shut down its side of the socket once it has sent the last
+//! one; the server closes the connection once it has answered them all.
+//! A client that takes more than SOCKET_SEND_TIMEOUT_SECONDS to make room
+//! for an answer is disconnected, and its other answers dropped.
+//!
+//! A socket file left at path is replaced. Throws std::runtime_error if
+//! the socket cannot be set up.
+void serve_unix_socket(PlannerService& service, const std::string& path, const ServiceRequest& defaults, const volatile std::sig_atomic_t& quit)
+{
+    struct Connection
+    {
+        int fd;
+        std::mutex write_mutex;
+        //! Whether an answer could not be sent; the rest are dropped.
+        bool broken = false;
+
+        explicit Connection(int fd_) : fd(fd_) {}
+        ~Connection() { ::close(fd); }
+    };
+
+    sockaddr_un address = unix_address(path);
+    struct stat existing;
+    if(::stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+    {
+        ::unlink(path.c_str());
+    }
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0)
+        throw socket_error("cannot create socket for", path);
+    if(::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 16) != 0)
+    {
+        std::runtime_error e = socket_error("cannot listen on", path);
+        ::close(listener);
+        throw e;
+    }
+
+    // Readers are detached, so that a long-running server does not keep
+    // the threads of past clients. This counts the ones still running; they
+    // share it, as the last of them may still hold its mutex when the
+    // server is done waiting.
+    struct Readers
+    {
+        std::mutex mutex;
+        std::condition_variable done;
+        unsigned running = 0;
+        std::vector<std::weak_ptr<Connection>> connections;
+    };
+    std::shared_ptr<Readers> readers = std::make_shared<Readers>();
+
+    while(!quit)
+    {
+        pollfd p {listener, POLLIN, 0};
+        if(::poll(&p, 1, SOCKET_POLL_MILLISECONDS) <= 0)
+            continue;
+        int fd = ::accept(listener, nullptr, nullptr);
+        if(fd < 0)
+            continue;
+        // Answers are written from the service's workers, which a client
+        // that stops reading must not hold up for long.
+        timeval send_timeout {SOCKET_SEND_TIMEOUT_SECONDS, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+
+        std::shared_ptr<Connection> connection = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> lock(readers->mutex);
+            auto closed = [](const std::weak_ptr<Connection>& c) { return c.expired(); };
+            readers->connections.erase(std::remove_if(readers->connections.begin(), readers->connections.end(), closed), readers->connections.end());
+            readers->connections.push_back(connection);
+            ++readers->running;
+        }
+        // The connection stays open until the reader and every answer
+        // pending on it are done with it.
+        std::thread([&service, &defaults, readers, connection]() {
+            FdLineReader reader(connection->fd);
+            auto next_line = [&reader](std::string& line) { return reader.next_line(line); };
+            ServiceRequest request;
+            std::string error;
+            while(read_request(next_line, defaults, request, error))
+            {
+                service.submit(request, error, [connection](const std::string& answer) {
+                    std::lock_guard<std::mutex> lock(connection->write_mutex);
+                    if(!connection->broken && !write_all(connection->fd, answer))
+                    {
+                        // Drop the client, which also ends its reader.
+                        connection->broken = true;
+                        ::shutdown(connection->fd, SHUT_RDWR);
+                    }
+                });
+            }
+
+            std::lock_guard<std::mutex> lock(readers->mutex);
+            --readers->running;
+            readers->done.notify_all();
+        }).detach();
+    }
+
+    ::close(listener);
+    ::unlink(path.c_str());
+
+    // Wake the readers still waiting for requests.
+    std::unique_lock<std::mutex> lock(readers->mutex);
+    for(const std::weak_ptr<Connection>& c : readers->connections)
+    {
+        if(std::shared_ptr<Connection> connection = c.lock())
+        {
+            ::shutdown(connection->fd, SHUT_RD);
+        }
+    }
+    readers->done.wait(lock, [&readers]() { return readers->running == 0; });
+    lock.unlock();
+
+    service.stop();
+}
+
+//! Send request, in the format read_request() reads, to the server at path
+//! and call on_answer with each line it answers with. Throws
+//! std::runtime_error if the server cannot be reached.
+void request_unix_socket(const std::string& path, const std::string& request, const std::function<void(const std::string&)>& on_answer)
+{
+    int fd = connect_unix_socket(path);
+    if(!write_all(fd, request))
+    {
+        std::runtime_error e = socket_error("cannot send to", path);
+        ::close(fd);
+        throw e;
+    }
+    ::shutdown(fd, SHUT_WR);
+
+    FdLineReader reader(fd);
+    std::string line;
+    while(reader.next_line(line))
+    {
+        on_answer(line);
+    }
+    ::close(fd);
+}
+
+#endif
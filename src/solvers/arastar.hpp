@@ -0,0 +1,369 @@
+#ifndef PLANNER_ARASTAR_HPP
+#define PLANNER_ARASTAR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "solvers/astar.hpp"
+#include "solvers/bucket_queue.hpp"
+#include "solvers/flat_hash.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+
+//! Heuristic weight of the first ARA* iteration.
+constexpr double ARA_INITIAL_WEIGHT = 3;
+
+//! How much ARA* lowers the weight after each iteration.
+constexpr double ARA_WEIGHT_STEP = 0.5;
+
+//! Anytime Repairing A* (Likhachev, Gordon and Thrun). Runs weighted A*
+//! with a decreasing heuristic weight, keeping the g values, open list and
+//! paths of one iteration for the next: only the States whose g improved
+//! after they were expanded are expanded again. Every iteration ends with
+//! a plan no worse than the last, and the final one, at weight 1, is an
+//! optimal plan.
+//!
+//! Each plan comes with a proven bound on its suboptimality: its cost over
+//! the lowest g + h on the open list. This usually drops below the weight,
+//! in which case the weight does too, and the search stops as soon as it
+//! reaches 1. Like A*, it only looks for plans within the problem's upper
+//! bound, so it never returns one worse than a plan known before.
+template<typename Problem>
+class ARAStarSolver
+{
+public:
+    //! Called with every plan better than the ones before it and the most
+    //! its cost can exceed the optimum by, as a factor.
+    typedef std::function<void(const BuildOrder&, double)> ImprovementCallback;
+
+    ARAStarSolver(Problem&& problem_ = Problem())
+        : problem(problem_)
+        , initial_weight(ARA_INITIAL_WEIGHT)
+        , weight_step(ARA_WEIGHT_STEP)
+        , stop_token(nullptr)
+        , bound(1)
+    {
+    }
+
+    //! Return the best plan found before the search ended: an optimal one
+    //! unless it was stopped first; see suboptimality().
+    bool solve(BuildOrder& result)
+    {
+        stats.start();
+        reporter.restart();
+        bound = std::numeric_limits<double>::infinity();
+
+        bool found = search(result);
+
+        reporter.finish(stats);
+        return found;
+    }
+
+    //! Send progress reports to os every interval seconds (never if 0) and
+    //! a final report when the search ends. os may be null to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+    }
+
+    //! Start at weight initial (at least 1) and lower it by step (more than
+    //! 0) after each iteration.
+    void set_weights(double initial, double step)
+    {
+        assert(initial >= 1 && step > 0);
+        initial_weight = initial;
+        weight_step = step;
+    }
+
+    //! Stop when token asks to (never if null), with the best plan found
+    //! so far.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    //! Call f with every improved plan as soon as it is found.
+    void set_improvement_callback(ImprovementCallback f)
+    {
+        on_improvement = f;
+    }
+
+    //! The most the cost of the last plan found can exceed the optimum by,
+    //! as a factor: 1 if it is optimal.
+    double suboptimality() const
+    {
+        return bound;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
+private:
+    static constexpr Time UNSOLVED = std::numeric_limits<Time>::max();
+
+    //! What the search knows about a State: the cheapest g found so far, and
+    //! the last iteration that expanded it (0 for none).
+    struct Seen
+    {
+        Time g;
+        std::uint32_t expanded_in;
+    };
+
+    //! Counts the open entries by g + h, for the lowest of them, which is a
+    //! lower bound on the optimal cost. Stale entries are counted until they
+    //! are popped; their g + h is never lower than that of the live entry,
+    //! so the bound stays valid. The counts start at the lowest f added, as
+    //! the open list's layers do.
+    class FCounts
+    {
+    public:
+        void add(Time f)
+        {
+            if(counts.empty())
+            {
+                base = f;
+            }
+            else if(f < base)
+            {
+                counts.insert(counts.begin(), std::size_t(base - f), 0);
+                base = f;
+            }
+            if(std::size_t(f - base) >= counts.size())
+            {
+                counts.resize(f - base + 1);
+            }
+            if(total == 0 || f < min_f)
+            {
+                min_f = f;
+            }
+            ++counts[f - base];
+            ++total;
+        }
+
+        void remove(Time f)
+        {
+            --counts[f - base];
+            --total;
+        }
+
+        void clear()
+        {
+            counts.clear();
+            total = 0;
+        }
+
+        //! The lowest f counted, or UNSOLVED if there is none.
+        Time min()
+        {
+            if(total == 0)
+                return UNSOLVED;
+            while(counts[min_f - base] == 0)
+            {
+                ++min_f;
+            }
+            return min_f;
+        }
+
+    private:
+        //! The counts by f - base.
+        std::vector<std::size_t> counts;
+        Time base = 0;
+        std::size_t total = 0;
+        Time min_f = 0;
+    };
+
+    //! The weighted f of an entry. Rounding down keeps it at least g + h.
+    static Time weighted_f(Time g, Time h, double weight)
+    {
+        return g + Time(std::floor(weight * h));
+    }
+
+    bool search(BuildOrder& result)
+    {
+        Node start = problem.start_node();
+
+        std::vector<SearchRecord> records;
+        FrontierPool frontier;
+        FlatHashMap<State, Seen> seen(SEEN_STATES_RESERVE);
+
+        BucketQueue<AstarNode> open;
+        // Entries whose State was expanded in this iteration before they
+        // were found. They wait for the next iteration.
+        std::vector<AstarNode> inconsistent;
+        FCounts f_counts;
+
+        Time incumbent = UNSOLVED;
+        // Entries at or beyond this cannot beat the incumbent, nor a plan
+        // known before the search.
+        Time prune_at = problem.upper_bound();
+        std::uint32_t iteration = 1;
+        double weight = initial_weight;
+
+        auto snapshot = [&]() {
+            stats.open_size = open.size() + inconsistent.size();
+            stats.closed_size = seen.size();
+            stats.memory_bytes = records.capacity() * sizeof(SearchRecord) +
+                                 frontier.memory_usage() +
+                                 open.memory_usage() +
+                                 inconsistent.capacity() * sizeof(AstarNode) +
+                                 seen.memory_usage();
+        };
+
+        auto proven_bound = [&]() {
+            Time lower = std::min(incumbent, f_counts.min());
+            return lower > 0 ? double(incumbent) / lower : std::numeric_limits<double>::infinity();
+        };
+
+        Time start_h = timed_heuristic(problem, start, stats);
+        records.push_back(SearchRecord {NO_PARENT, NO_ACTION, start.t});
+        seen.insert(start.state, Seen {start.t, 0});
+        open.push(AstarNode {weighted_f(start.t, start_h, weight), start_h, start.t, 0, frontier.store(start), 0});
+        f_counts.add(start.t + start_h);
+
+        while(true)
+        {
+            // Expand until no entry could lead to a better plan at this
+            // weight.
+            while(!open.empty() && open.top().f < prune_at)
+            {
+                AstarNode node = open.top();
+                open.pop();
+                f_counts.remove(node.g + node.h);
+                Node n = frontier.take(node.slot);
+                Seen& s = *seen.find(n.state);
+                if(node.g > s.g || s.expanded_in == iteration)
+                {
+                    ++stats.duplicates;
+                    continue;
+                }
+
+                if(problem.is_goal(n))
+                {
+                    incumbent = node.g;
+                    prune_at = incumbent;
+                    stats.set_f_bound(incumbent);
+                    result = replay_solution(start, trace_actions(records, node.record));
+                    assert(result.back().state == n.state);
+                    bound = proven_bound();
+                    if(on_improvement)
+                    {
+                        on_improvement(result, bound);
+                    }
+                    continue;
+                }
+
+                s.expanded_in = iteration;
+                ++stats.expanded;
+                problem.visit_neighbors(n, [&](Node&& succ) mutable {
+                    ++stats.generated;
+                    Time g = succ.t;
+                    std::pair<Seen*, bool> known = seen.insert(succ.state, Seen {g, 0});
+                    if(!known.second && g >= known.first->g)
+                    {
+                        ++stats.duplicates;
+                        return;
+                    }
+                    known.first->g = g;
+
+                    Time h = timed_heuristic(problem, succ, stats);
+                    if(g + h >= prune_at)
+                        return;
+
+                    assert(records.size() < NO_PARENT);
+                    records.push_back(SearchRecord {node.record, succ.action.id, g});
+                    succ.predecessor = nullptr;
+
+                    AstarNode entry {weighted_f(g, h, weight), h, g, std::uint32_t(records.size() - 1), frontier.store(succ), node.depth + 1};
+                    f_counts.add(g + h);
+                    if(known.first->expanded_in == iteration)
+                    {
+                        inconsistent.push_back(entry);
+                    }
+                    else
+                    {
+                        open.push(entry);
+                    }
+                });
+
+                if(reporter.due())
+                {
+                    snapshot();
+                    reporter.progress(stats);
+                }
+
+                if(should_stop(stop_token, stats.expanded))
+                {
+                    stats.stopped = true;
+                    stats.lower_bound = std::min(incumbent, f_counts.min());
+                    snapshot();
+                    return incumbent != UNSOLVED;
+                }
+            }
+
+            if(incumbent != UNSOLVED)
+            {
+                bound = proven_bound();
+            }
+            if(bound <= 1 || (open.empty() && inconsistent.empty()))
+            {
+                // Nothing left that could lead to a better plan, or to one
+                // within the upper bound.
+                bound = 1;
+                stats.lower_bound = std::min(prune_at, f_counts.min());
+                break;
+            }
+
+            // The next weight need not be higher than what is proven already.
+            weight = std::max(1.0, std::min(weight - weight_step, bound));
+            ++iteration;
+
+            // Reorder what is left of the open list by the new weight, and
+            // give the inconsistent States another chance.
+            BucketQueue<AstarNode> reordered;
+            f_counts.clear();
+            auto requeue = [&](AstarNode node) {
+                if(node.g > seen.find(frontier.peek(node.slot).state)->g || node.g + node.h >= prune_at)
+                {
+                    frontier.take(node.slot);
+                    return;
+                }
+                node.f = weighted_f(node.g, node.h, weight);
+                f_counts.add(node.g + node.h);
+                reordered.push(node);
+            };
+            for(; !open.empty(); open.pop())
+            {
+                requeue(open.top());
+            }
+            for(const AstarNode& node : inconsistent)
+            {
+                requeue(node);
+            }
+            std::vector<AstarNode>().swap(inconsistent);
+            std::swap(open, reordered);
+        }
+
+        snapshot();
+        return incumbent != UNSOLVED;
+    }
+
+    Problem problem;
+    double initial_weight;
+    double weight_step;
+    const StopToken* stop_token;
+    ImprovementCallback on_improvement;
+
+    SearchStatistics stats;
+    StatisticsReporter reporter;
+    double bound;
+};
+
+#endif
@@ -1,85 +1,379 @@
 #ifndef PLANNER_ASTAR_HPP
 #define PLANNER_ASTAR_HPP
 
-#include <deque>
-#include <queue>
-#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <new>
+#include <vector>
 #include <iostream>
 
 #include "definitions/types.hpp"
 #include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "solvers/bucket_queue.hpp"
+#include "solvers/dominance.hpp"
+#include "solvers/flat_hash.hpp"
+#include "solvers/ida.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
 
+//! Frontier entry. The full Node lives in the frontier pool until expanded.
 struct AstarNode
 {
     Time f, h, g;
-    const Node* n;
+    std::uint32_t record;
+    std::uint32_t slot;
     unsigned int depth;
 };
 
-bool operator>(const AstarNode& a, const AstarNode& b) {
-    return a.f > b.f || (a.f == b.f && a.h > b.h) || (a.f == b.f && a.h == b.h && a.depth > b.depth);
-    // return a.f > b.f || (a.f == b.f && a.depth > b.depth) || (a.f == b.f && a.depth == b.depth && a.h > b.h);
+constexpr std::uint32_t NO_PARENT = std::numeric_limits<std::uint32_t>::max();
+
+//! What A* remembers about every generated node: enough to replay the
+//! path to it from the start node.
+struct SearchRecord
+{
+    std::uint32_t parent;
+    ActionId action;
+    Time g;
+};
+
+//! Follow parent links back to the start and return the actions in order.
+std::vector<ActionId> trace_actions(const std::vector<SearchRecord>& records, std::uint32_t i)
+{
+    std::vector<ActionId> actions;
+    for(; records[i].parent != NO_PARENT; i = records[i].parent)
+    {
+        actions.push_back(records[i].action);
+    }
+    std::reverse(actions.begin(), actions.end());
+    return actions;
 }
 
+//! Storage for the full Nodes on the frontier, recycling expanded slots.
+class FrontierPool
+{
+public:
+    std::uint32_t store(const Node& n)
+    {
+        if(free_slots.empty())
+        {
+            nodes.push_back(n);
+            return nodes.size() - 1;
+        }
+        std::uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        nodes[slot] = n;
+        return slot;
+    }
+
+    const Node& peek(std::uint32_t slot) const
+    {
+        return nodes[slot];
+    }
+
+    Node take(std::uint32_t slot)
+    {
+        free_slots.push_back(slot);
+        return nodes[slot];
+    }
+
+    std::size_t capacity() const { return nodes.size(); }
+
+    //! Bytes that storing extra more nodes may allocate on top of
+    //! memory_usage().
+    std::size_t growth_memory(std::size_t extra) const
+    {
+        std::size_t reused = std::min(extra, free_slots.size());
+        return vector_growth(nodes, extra - reused) + vector_growth(free_slots, extra);
+    }
+
+    std::size_t memory_usage() const
+    {
+        return nodes.capacity() * sizeof(Node) + free_slots.capacity() * sizeof(std::uint32_t);
+    }
+
+private:
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> free_slots;
+};
+
+//! Best-g index entries allocated up front. The index grows as it fills,
+//! so a search only pays for the States it reaches.
+constexpr std::size_t SEEN_STATES_RESERVE = 1 << 10;
+
+//! Expansions between checks of the memory budget. Each check makes sure
+//! that the nodes the next ones may generate fit, with the old and new
+//! arrays of every table that grows.
+constexpr std::size_t MEMORY_CHECK_PERIOD = 4096;
+
 template<typename Problem>
 class AStarSolver
 {
 public:
+    //! Called with a State and a lower bound on the ticks from it to the
+    //! goal; see set_bound_callback().
+    typedef std::function<void(const State&, Time)> BoundCallback;
+
     AStarSolver(Problem&& problem_ = Problem())
         : problem(problem_)
+        , prune_dominated(false)
+        , memory_budget(0)
+        , stop_token(nullptr)
     {
     }
 
     bool solve(BuildOrder& result)
+    {
+        stats.start();
+        reporter.restart();
+
+        Outcome outcome;
+        try
+        {
+            outcome = search(result);
+        }
+        catch(const std::bad_alloc&)
+        {
+            // Everything search() allocated has been freed again.
+            outcome = OVER_BUDGET;
+        }
+
+        if(outcome == OVER_BUDGET)
+        {
+            reporter.handover(stats);
+            return finish_with_ida(result);
+        }
+
+        if(outcome == STOPPED)
+        {
+            // Every f expanded so far was at most the optimal cost.
+            stats.stopped = true;
+            stats.lower_bound = stats.f_layers.empty() ? 0 : stats.f_bound;
+        }
+        reporter.finish(stats);
+        return outcome == SOLVED;
+    }
+
+    //! Send progress reports to os every interval seconds (never if 0) and
+    //! a final report when the search ends. os may be null to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+    }
+
+    //! Drop nodes dominated by one seen no later; see dominates().
+    void set_dominance_pruning(bool enabled)
+    {
+        prune_dominated = enabled;
+    }
+
+    //! Once the search uses more than bytes (0 for no limit), or runs out of
+    //! memory, drop everything and let IDA* finish from the f bound reached
+    //! so far. The result is still optimal.
+    void set_memory_budget(std::size_t bytes)
+    {
+        memory_budget = bytes;
+    }
+
+    //! Stop when token asks to (never if null). A* has no plan before it
+    //! has an optimal one, so a stopped search only proves a lower bound.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    //! Once an optimal plan of cost C is found, call f with every State the
+    //! search reached and C minus the lowest g it was reached at. That is a
+    //! lower bound on the ticks from the State to the goal, as a plan
+    //! through it would otherwise be cheaper; see SearchMemory.
+    void set_bound_callback(BoundCallback f)
+    {
+        on_bound = f;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
+private:
+    enum Outcome
+    {
+        SOLVED,
+        NO_SOLUTION,
+        OVER_BUDGET,
+        STOPPED
+    };
+
+    Outcome search(BuildOrder& result)
     {
         Node start = problem.start_node();
 
-        std::deque<Node> nodes;
+        std::vector<SearchRecord> records;
+        FrontierPool frontier;
 
-        std::priority_queue<AstarNode, std::vector<AstarNode>, std::greater<AstarNode>> open;
-        std::unordered_set<State> closed;
+        BucketQueue<AstarNode> open;
+        // Open and closed states alike, with the cheapest g they were
+        // reached at. Successors that do no better are dropped right away;
+        // a cheaper path pushes a new entry, and the old one goes stale.
+        FlatHashMap<State, Time> best_g(SEEN_STATES_RESERVE);
+        DominanceIndex dominance;
 
-        open.push(AstarNode {problem.heuristic(start), problem.heuristic(start), 0, &start, 0});
+        auto snapshot = [&]() {
+            stats.open_size = open.size();
+            stats.closed_size = best_g.size();
+            stats.memory_bytes = records.capacity() * sizeof(SearchRecord) +
+                                 frontier.memory_usage() +
+                                 open.memory_usage() +
+                                 best_g.memory_usage() +
+                                 dominance.memory_usage();
+        };
+
+        Time start_h = timed_heuristic(problem, start, stats);
+        // Every plan of the upper bound or beyond is beaten by a known one.
+        Time prune_at = problem.upper_bound();
+        records.push_back(SearchRecord {NO_PARENT, NO_ACTION, start.t});
+        best_g.insert(start.state, start.t);
+        if(prune_dominated)
+        {
+            dominance.dominated(start);
+        }
+        open.push(AstarNode {start.t + start_h, start_h, start.t, 0, frontier.store(start), 0});
 
         while(!open.empty())
         {
             AstarNode node = open.top();
             open.pop();
-            auto r = closed.insert(node.n->state);
-            if(!r.second) // State already in closed set.
+            Node n = frontier.take(node.slot);
+            if(node.g > *best_g.find(n.state))
             {
-                // Duplicate states may arise from not having decrease-key.
+                // Superseded by a cheaper path to the same State.
+                ++stats.duplicates;
                 continue;
             }
 
-            if(problem.is_goal(*node.n))
+            if(stats.f_layers.empty() || node.f > stats.f_bound)
+            {
+                stats.set_f_bound(node.f);
+            }
+
+            if(problem.is_goal(n))
             {
-                result = extract_solution(*node.n);
-                std::cerr << "Enqueued " << nodes.size() << " nodes." << std::endl;
-                std::cerr << "Expanded " << (nodes.size() - open.size()) << " nodes." << std::endl;
-                std::cerr << "Closed set load factor: " << closed.load_factor() << std::endl;
-                return true;
+                result = replay_solution(start, trace_actions(records, node.record));
+                assert(result.back().state == n.state);
+                stats.lower_bound = n.t;
+                snapshot();
+                if(on_bound)
+                {
+                    best_g.for_each([this, &n](const State& s, Time g) { on_bound(s, n.t - g); });
+                }
+                return SOLVED;
             }
             else
             {
-                problem.visit_neighbors(*node.n, [this, &open, &closed, &nodes, &node](Node&& n) mutable {
-                    if(closed.count(n.state) == 0)
+                ++stats.expanded;
+                problem.visit_neighbors(n, [this, &open, &best_g, &dominance, &records, &frontier, &node, prune_at](Node&& succ) mutable {
+                    ++stats.generated;
+                    Time g = succ.t;
+                    std::pair<Time*, bool> seen = best_g.insert(succ.state, g);
+                    if(!seen.second && g >= *seen.first)
+                    {
+                        ++stats.duplicates;
+                    }
+                    else if(prune_dominated && dominance.dominated(succ))
                     {
-                        Time h = problem.heuristic(n);
-                        Time g = n.t;
+                        *seen.first = g;
+                        ++stats.dominated;
+                    }
+                    else
+                    {
+                        *seen.first = g;
+                        Time h = timed_heuristic(problem, succ, stats);
+                        if(g + h >= prune_at)
+                            return;
 
-                        nodes.push_back(std::move(n));
+                        assert(records.size() < NO_PARENT);
+                        records.push_back(SearchRecord {node.record, succ.action.id, g});
+                        succ.predecessor = nullptr;
 
-                        open.push(AstarNode { g + h, h, g, &nodes.back(), node.depth + 1 });
+                        open.push(AstarNode { g + h, h, g, std::uint32_t(records.size() - 1), frontier.store(succ), node.depth + 1 });
                     }
                 });
+
+                if(reporter.due())
+                {
+                    snapshot();
+                    reporter.progress(stats);
+                }
+
+                if(memory_budget > 0 && stats.expanded % MEMORY_CHECK_PERIOD == 0)
+                {
+                    snapshot();
+                    // The open list and the dominance index grow in small
+                    // steps, by about a node and a State per node.
+                    std::size_t extra = MEMORY_CHECK_PERIOD * NUM_ACTIONS;
+                    std::size_t projected = stats.memory_bytes +
+                                            vector_growth(records, extra) +
+                                            frontier.growth_memory(extra) +
+                                            best_g.growth_memory(extra) +
+                                            extra * (sizeof(AstarNode) + sizeof(State));
+                    if(projected > memory_budget)
+                        return OVER_BUDGET;
+                }
+
+                if(should_stop(stop_token, stats.expanded))
+                {
+                    snapshot();
+                    return STOPPED;
+                }
             }
         }
 
-        return false;
+        stats.lower_bound = stats.f_bound;
+        snapshot();
+        return NO_SOLUTION;
     }
-private:
+
+    //! Every f expanded so far was at most the optimal cost, so IDA* can
+    //! start from the highest one.
+    bool finish_with_ida(BuildOrder& result)
+    {
+        IDASolver<Problem> ida((Problem(problem)));
+        ida.set_reporting(reporter.stream(), reporter.period());
+        ida.set_stop_token(stop_token);
+        if(!stats.f_layers.empty())
+        {
+            ida.set_lower_bound(stats.f_bound);
+        }
+        if(memory_budget > 0)
+        {
+            // The table rounds up to a power of two, so this stays within
+            // about half the budget.
+            ida.set_transposition_table(memory_budget / 4 / sizeof(State), TTReplacement::LARGER_SUBTREE);
+        }
+
+        bool solved = ida.solve(result);
+
+        const SearchStatistics& ida_stats = ida.statistics();
+        stats.merge(ida_stats);
+        stats.open_size = ida_stats.open_size;
+        stats.closed_size = ida_stats.closed_size;
+        stats.memory_bytes = ida_stats.memory_bytes;
+        stats.set_f_bound(ida_stats.f_bound);
+        stats.stopped = ida_stats.stopped;
+        stats.lower_bound = ida_stats.lower_bound;
+        return solved;
+    }
+
     Problem problem;
+    bool prune_dominated;
+    std::size_t memory_budget;
+    const StopToken* stop_token;
+    BoundCallback on_bound;
+
+    SearchStatistics stats;
+    StatisticsReporter reporter;
 };
 
 #endif
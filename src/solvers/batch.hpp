@@ -0,0 +1,258 @@
+#ifndef PLANNER_BATCH_HPP
+#define PLANNER_BATCH_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "problems/buildorder.hpp"
+#include "problems/specification.hpp"
+#include "solvers/dispatch.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+
+//! Write s as a JSON string.
+inline void write_json_string(std::ostream& os, const std::string& s)
+{
+    os << '"';
+    for(char c : s)
+    {
+        if(c == '"' || c == '\\')
+        {
+            os << '\\' << c;
+        }
+        else if((unsigned char)c < 0x20)
+        {
+            os << ' ';
+        }
+        else
+        {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+//! The outcome of solving one problem.
+struct SolveResult
+{
+    bool solved = false;
+    BuildOrder plan;
+    SearchStatistics stats;
+    double seconds = 0;
+    //! Whether the plan is the rest of one found before, without a search.
+    bool reused = false;
+    //! What went wrong, if the solver threw.
+    std::string error;
+};
+
+//! Solve the problem of spec with the solver options ask for, sharing
+//! cache with other problems of the same constants, which must be those in
+//! effect, and raising the heuristic with memory if not null. It is stopped
+//! after time_limit seconds (never if 0) or when stop stops, if not null.
+//! A plan memory can repair bounds the search like a stored one.
+//!
+//! With a store in options, a plan it knows to be optimal is the answer
+//! without a search; otherwise the bounds it knows start the search, and
+//! what the search finds is stored.
+SolveResult solve_specification(const ProblemSpecification& spec, const SolverOptions& options, std::shared_ptr<GatherCache> cache, double time_limit, const StopToken* stop, const SearchMemory* memory = nullptr)
+{
+    SolveResult r;
+    StopToken deadline(time_limit, stop);
+    SearchClock::time_point started = SearchClock::now();
+    StoredSolution known;
+    try
+    {
+        if(options.store && options.store->find(spec, known) && known.optimal())
+        {
+            r.solved = true;
+            r.reused = true;
+            r.plan = known.plan;
+            r.stats.lower_bound = r.plan.back().t;
+        }
+        else
+        {
+            BuildOrderProblem problem = spec.problem(std::move(cache));
+            problem.set_search_memory(memory);
+            BuildOrder repaired;
+            if(memory != nullptr &&
+               memory->repair(problem.start_node(), [&problem](const Node& n) { return problem.is_goal(n); }, repaired) &&
+               (known.plan.empty() || repaired.back().t < known.plan.back().t))
+            {
+                known.plan.swap(repaired);
+            }
+            problem.set_known_bounds(known.lower_bound, known.plan.empty() ? NEVER : known.plan.back().t - spec.start_time);
+            r.solved = run_solver(options, problem, &deadline, r.plan, r.stats);
+
+            // The search may stop before it improves on what was known.
+            r.stats.lower_bound = std::max(r.stats.lower_bound, spec.start_time + known.lower_bound);
+            if(!known.plan.empty() && (!r.solved || known.plan.back().t < r.plan.back().t))
+            {
+                r.solved = true;
+                r.plan = known.plan;
+            }
+        }
+    }
+    catch(const std::exception& e)
+    {
+        r.error = e.what();
+    }
+
+    // Plans and bounds cut short by the capacity of State are not those of
+    // the problem.
+    if(options.store && !r.reused && r.error.empty() && r.stats.capacity_cuts == 0 && (r.solved || r.stats.stopped))
+    {
+        try
+        {
+            options.store->record(spec, r.stats.lower_bound - spec.start_time, r.solved ? &r.plan : nullptr);
+        }
+        catch(const std::exception& e)
+        {
+            // A plan found stands even if it cannot be stored.
+            if(!r.solved)
+                r.error = e.what();
+        }
+    }
+    r.seconds = std::chrono::duration<double>(SearchClock::now() - started).count();
+    return r;
+}
+
+//! Write a line of JSON saying that the problem called name, the index-th
+//! one, could not be solved because of error.
+inline void write_error_json(std::ostream& os, const std::string& name, std::size_t index, const std::string& error)
+{
+    os << "{\"instance\": ";
+    write_json_string(os, name);
+    os << ", \"index\": " << index << ", \"error\": ";
+    write_json_string(os, error);
+    os << "}" << std::endl;
+}
+
+//! Write r as a line of JSON, with its plan if there is one.
+inline void write_result_json(std::ostream& os, const std::string& name, std::size_t index, const SolverKind solver, const unsigned goal_zps, const SolveResult& r)
+{
+    if(!r.error.empty())
+    {
+        write_error_json(os, name, index, r.error);
+        return;
+    }
+
+    os << "{\"instance\": ";
+    write_json_string(os, name);
+    os << ", \"index\": " << index
+       << ", \"solver\": \"" << solver_name(solver) << "\""
+       << ", \"goal_zps\": " << goal_zps
+       << ", \"solved\": " << (r.solved ? "true" : "false");
+    if(r.solved)
+    {
+        os << ", \"makespan\": " << r.plan.back().t;
+    }
+    if(r.reused)
+    {
+        os << ", \"reused\": true";
+    }
+    if(r.stats.capacity_cuts > 0)
+    {
+        os << ", \"capacity_cuts\": " << r.stats.capacity_cuts;
+    }
+    os << ", \"stopped\": " << (r.stats.stopped ? "true" : "false")
+       << ", \"lower_bound\": " << r.stats.lower_bound
+       << ", \"seconds\": " << r.seconds
+       << ", \"expanded\": " << r.stats.expanded
+       << ", \"generated\": " << r.stats.generated
+       << ", \"memory_bytes\": " << r.stats.memory_bytes;
+    if(r.solved)
+    {
+        os << ", \"plan\": [";
+        for(std::size_t i = 1; i < r.plan.size(); ++i)
+        {
+            const Node& n = r.plan[i];
+            os << (i > 1 ? ", " : "") << "{\"t\": " << n.t << ", \"action\": ";
+            write_json_string(os, n.action.description);
+            os << ", \"lc\": " << n.state.lc << ", \"qp\": " << n.state.qp << "}";
+        }
+        os << "]";
+    }
+    os << "}" << std::endl;
+}
+
+//! Solve every problem of a batch with jobs worker threads, each solving
+//! one problem at a time with the solver options ask for, and write one
+//! line of JSON per problem to os as soon as it is solved. Lines come in the
+//! order the problems finish; each names its problem and its index in
+//! instances.
+//!
+//! The game constants are global, so problems are run in groups with the
+//! same constants, one group after the other, and the problems of a group
+//! share the heuristic cache. Each problem gets its own time limit (none if
+//! 0) and, for A*, its own memory budget; progress reports are off. stop,
+//! if not null, stops every problem still running and skips the rest.
+void run_batch(const std::vector<BatchInstance>& instances, SolverOptions options, unsigned jobs, double time_limit, std::ostream& os, const StopToken* stop = nullptr)
+{
+    options.report_stream = nullptr;
+    options.on_improvement = nullptr;
+    jobs = std::max(jobs, 1u);
+
+    std::vector<std::vector<std::size_t>> groups;
+    for(std::size_t i = 0; i < instances.size(); ++i)
+    {
+        auto same = [&](const std::vector<std::size_t>& g) {
+            return same_constants(instances[g.front()].spec.constants, instances[i].spec.constants);
+        };
+        auto group = std::find_if(groups.begin(), groups.end(), same);
+        if(group == groups.end())
+        {
+            groups.push_back(std::vector<std::size_t> {i});
+        }
+        else
+        {
+            group->push_back(i);
+        }
+    }
+
+    std::mutex output;
+    for(const std::vector<std::size_t>& group : groups)
+    {
+        // No search is running, so the constants can change.
+        instances[group.front()].spec.apply_constants();
+        std::shared_ptr<GatherCache> cache = std::make_shared<GatherCache>();
+
+        std::atomic<std::size_t> next(0);
+        auto work = [&]() {
+            for(std::size_t k; (k = next.fetch_add(1)) < group.size();)
+            {
+                if(stop != nullptr && stop->stop_requested())
+                    return;
+
+                const BatchInstance& instance = instances[group[k]];
+                SolveResult r = solve_specification(instance.spec, options, cache, time_limit, stop);
+
+                std::lock_guard<std::mutex> lock(output);
+                write_result_json(os, instance.name, group[k], options.kind, instance.spec.goal_zps, r);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for(std::size_t j = 1; j < std::min<std::size_t>(jobs, group.size()); ++j)
+        {
+            workers.emplace_back(work);
+        }
+        work();
+        for(std::thread& t : workers)
+        {
+            t.join();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef PLANNER_BUCKET_QUEUE_HPP
+#define PLANNER_BUCKET_QUEUE_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "definitions/types.hpp"
+
+//! Open list for non-negative integer f values within a small range, such
+//! as the tick counts A* works with: the layers start at the lowest f
+//! pushed, not at 0, so a search starting late in the game costs no more
+//! than one from its start. Entries are bucketed by f and come out lowest f
+//! first. Within an f, each layer is a binary heap on h, then depth: lowest
+//! h first and, among equal h (and so equal g), the deepest first. A layer
+//! only holds the entries pushed to it, however widely their h values vary.
+//!
+//! Moving between layers is O(1) amortized: popping only ever scans forward
+//! from the lowest non-empty layer, and a push below it just moves it back.
+//! Within a layer, push and pop are O(log n) in the entries of that f.
+//! T needs Time members f and h and an unsigned depth.
+template<typename T>
+class BucketQueue
+{
+public:
+    BucketQueue()
+        : base(0)
+        , min_f(0)
+        , count(0)
+    {
+    }
+
+    bool empty() const { return count == 0; }
+    std::size_t size() const { return count; }
+
+    void push(const T& x)
+    {
+        assert(x.f >= 0 && x.h >= 0);
+        if(layers.empty())
+        {
+            base = x.f;
+        }
+        else if(x.f < base)
+        {
+            // Rare: only an inconsistent heuristic lowers f below the start.
+            layers.insert(layers.begin(), std::size_t(base - x.f), std::vector<T>());
+            base = x.f;
+        }
+        if(std::size_t(x.f - base) >= layers.size())
+        {
+            layers.resize(x.f - base + 1);
+        }
+        if(count == 0 || x.f < min_f)
+        {
+            min_f = x.f;
+        }
+
+        std::vector<T>& layer = layers[x.f - base];
+        layer.push_back(x);
+        std::push_heap(layer.begin(), layer.end(), PopsLater());
+        ++count;
+    }
+
+    //! The entry pop() would remove. Not const, as it moves the scan
+    //! position up to that entry.
+    const T& top()
+    {
+        return first_layer().front();
+    }
+
+    void pop()
+    {
+        std::vector<T>& layer = first_layer();
+        std::pop_heap(layer.begin(), layer.end(), PopsLater());
+        layer.pop_back();
+        --count;
+        if(layer.empty())
+        {
+            // The search has moved past this f, normally for good.
+            std::vector<T>().swap(layer);
+        }
+    }
+
+    std::size_t memory_usage() const
+    {
+        std::size_t bytes = layers.capacity() * sizeof(std::vector<T>);
+        for(const std::vector<T>& layer : layers)
+        {
+            bytes += layer.capacity() * sizeof(T);
+        }
+        return bytes;
+    }
+
+private:
+    //! Heap order within a layer: true if a comes out after b.
+    struct PopsLater
+    {
+        bool operator()(const T& a, const T& b) const
+        {
+            return a.h > b.h || (a.h == b.h && a.depth < b.depth);
+        }
+    };
+
+    std::vector<T>& first_layer()
+    {
+        assert(count > 0);
+        while(layers[min_f - base].empty())
+        {
+            ++min_f;
+        }
+        return layers[min_f - base];
+    }
+
+    //! The heaps by f - base.
+    std::vector<std::vector<T>> layers;
+    Time base;
+    //! No entry has a lower f than this.
+    Time min_f;
+    std::size_t count;
+};
+
+#endif
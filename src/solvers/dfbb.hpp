@@ -1,21 +1,26 @@
 #ifndef PLANNER_DFBB_HPP
 #define PLANNER_DFBB_HPP
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include <functional>
 
 #include "definitions/state.hpp"
+#include "solvers/dominance.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
 
-void log_partial_solution(const Node& final_state)
+void log_partial_solution(std::ostream& os, const Node& final_state)
 {
     for(const Node* n = &final_state; n != nullptr; n = n->predecessor)
     {
         if(n->predecessor)
         {
-            std::cerr << *n << '\n';
+            os << *n << '\n';
         }
     }
-    std::cerr.flush();
+    os << std::endl;
 }
 
 //! Depth-first branch and bound solver
@@ -25,18 +30,48 @@ class DFBBSolver
 public:
     DFBBSolver(Problem&& problem_ = Problem())
         : problem(problem_)
+        , prune_dominated(false)
+        , stop_token(nullptr)
+        , stopping(false)
         , found(false)
     {
     }
 
     bool solve(BuildOrder& result)
     {
+        stats.start();
+        reporter.restart();
         found = false;
+        stopping = false;
+        depth = 0;
         upper_bound = problem.upper_bound();
+        // Without a bound the depth-first search would never come back.
+        if(upper_bound == NEVER)
+            throw std::runtime_error("dfbb: no simple plan bounds the search from this start; try astar");
+        stats.set_f_bound(upper_bound);
+        dominance.clear();
 
         Node start = problem.start_node();
+        if(prune_dominated)
+        {
+            dominance.dominated(start);
+        }
         dfbb(start);
 
+        if(stopping)
+        {
+            // Depth-first, nothing is known about the unexplored subtrees
+            // beyond the heuristic.
+            stats.stopped = true;
+            stats.lower_bound = std::min(upper_bound, start.t + timed_heuristic(problem, start, stats));
+        }
+        else
+        {
+            // Nothing cheaper than the incumbent, or the initial bound.
+            stats.lower_bound = upper_bound;
+        }
+        snapshot();
+        reporter.finish(stats);
         if(found)
         {
             result = best;
@@ -47,6 +82,33 @@ public:
             return false;
         }
     }
+
+    //! Send progress reports to os every interval seconds (never if 0), every
+    //! improved plan, and a final report when the search ends. os may be null
+    //! to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+    }
+
+    //! Drop nodes dominated by one seen no later; see dominates(). The
+    //! nodes seen are kept for the whole search, so this costs memory.
+    void set_dominance_pruning(bool enabled)
+    {
+        prune_dominated = enabled;
+    }
+
+    //! Stop when token asks to (never if null), with the best plan found
+    //! so far.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
 private:
     void dfbb(const Node& n)
     {
@@ -54,28 +116,73 @@ private:
         {
             if(n.t < upper_bound)
             {
-                log_partial_solution(n); std::cout << std::endl;
+                if(reporter.stream() != nullptr)
+                {
+                    log_partial_solution(*reporter.stream(), n);
+                }
                 found = true;
                 best = extract_solution(n);
                 upper_bound = n.t;
+                stats.set_f_bound(upper_bound);
             }
         }
         else
         {
+            ++stats.expanded;
+            if(should_stop(stop_token, stats.expanded))
+            {
+                stopping = true;
+                return;
+            }
+
+            ++depth;
             using namespace std::placeholders;
             problem.visit_neighbors(n, std::bind(&DFBBSolver::neighbor_visitor, this, _1));
+            --depth;
+
+            if(reporter.due())
+            {
+                snapshot();
+                reporter.progress(stats);
+            }
         }
     }
 
     void neighbor_visitor(const Node& n)
     {
-        if(n.t + problem.heuristic(n) < upper_bound)
+        if(stopping)
+            return;
+
+        ++stats.generated;
+        if(n.t + timed_heuristic(problem, n, stats) >= upper_bound)
+            return;
+
+        if(prune_dominated && dominance.dominated(n))
         {
-            dfbb(n);
+            ++stats.dominated;
+            return;
         }
+
+        dfbb(n);
+    }
+
+    void snapshot()
+    {
+        // The open list is the recursion stack.
+        stats.open_size = depth;
+        stats.closed_size = dominance.size();
+        stats.memory_bytes = depth * sizeof(Node) + best.capacity() * sizeof(Node) + dominance.memory_usage();
     }
 
     Problem problem;
+    bool prune_dominated;
+    DominanceIndex dominance;
+    const StopToken* stop_token;
+    bool stopping;
+
+    SearchStatistics stats;
+    StatisticsReporter reporter;
+    std::size_t depth;
 
     bool found;
     BuildOrder best;
@@ -0,0 +1,177 @@
+#ifndef PLANNER_DISPATCH_HPP
+#define PLANNER_DISPATCH_HPP
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "definitions/types.hpp"
+#include "problems/solution_store.hpp"
+#include "solvers/arastar.hpp"
+#include "solvers/astar.hpp"
+#include "solvers/dfbb.hpp"
+#include "solvers/external_astar.hpp"
+#include "solvers/hdastar.hpp"
+#include "solvers/ida.hpp"
+#include "solvers/parallel_dfbb.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+
+enum class SolverKind
+{
+    ASTAR,
+    DFBB,
+    IDA,
+    PARALLEL_DFBB,
+    HDASTAR,
+    EXTERNAL_ASTAR,
+    ARASTAR
+};
+
+const struct
+{
+    SolverKind kind;
+    const char* name;
+} SOLVER_NAMES[] = {
+    {SolverKind::ASTAR, "astar"},
+    {SolverKind::DFBB, "dfbb"},
+    {SolverKind::IDA, "ida"},
+    {SolverKind::PARALLEL_DFBB, "parallel-dfbb"},
+    {SolverKind::HDASTAR, "hdastar"},
+    {SolverKind::EXTERNAL_ASTAR, "external-astar"},
+    {SolverKind::ARASTAR, "arastar"},
+};
+
+//! Return the solver called name, or throw std::runtime_error.
+SolverKind parse_solver_kind(const std::string& name)
+{
+    for(const auto& s : SOLVER_NAMES)
+    {
+        if(name == s.name)
+            return s.kind;
+    }
+    throw std::runtime_error("unknown solver '" + name + "'");
+}
+
+const char* solver_name(const SolverKind kind)
+{
+    for(const auto& s : SOLVER_NAMES)
+    {
+        if(kind == s.kind)
+            return s.name;
+    }
+    return "?";
+}
+
+//! Which solver to run and how. Options that do not apply to the chosen
+//! solver are ignored.
+struct SolverOptions
+{
+    SolverKind kind = SolverKind::ASTAR;
+
+    //! Where progress reports go, or null for none, and the seconds between
+    //! them (0 for only the final one).
+    std::ostream* report_stream = &std::cerr;
+    double report_interval = 10;
+
+    //! A* and DFBB: drop states dominated by one reached no later.
+    bool dominance_pruning = true;
+    //! A* and HDA*: bytes to use before handing over to IDA*, 0 for no
+    //! limit.
+    std::size_t memory_budget = std::size_t(4) << 30;
+    //! Parallel DFBB and HDA*: worker threads.
+    unsigned threads = std::thread::hardware_concurrency();
+    //! External-memory A*: where to keep the search files.
+    std::string scratch_directory = "/tmp";
+    //! External-memory A*: hash partitions of the search files.
+    unsigned partitions = 16;
+    //! External-memory A*: bytes of successors, and of recently closed
+    //! States, to buffer before writing them out.
+    std::size_t external_buffer = EXTERNAL_BUFFER_BYTES;
+    //! ARA*: called with every improved plan and its suboptimality bound.
+    std::function<void(const BuildOrder&, double)> on_improvement;
+    //! A*: called with the bounds an optimal search proves; see
+    //! AStarSolver::set_bound_callback().
+    std::function<void(const State&, Time)> on_bound;
+    //! Any solver, through solve_specification(): plans and bounds kept
+    //! across runs, or null for none.
+    std::shared_ptr<SolutionStore> store;
+};
+
+namespace dispatch_detail {
+
+template<typename Solver, typename Problem>
+bool run(Solver& solver, const Problem& problem, const SolverOptions& options, const StopToken* stop, BuildOrder& result, SearchStatistics& stats)
+{
+    solver.set_reporting(options.report_stream, options.report_interval);
+    solver.set_stop_token(stop);
+    bool solved = solver.solve(result);
+    stats = solver.statistics();
+    stats.capacity_cuts = problem.capacity_cuts();
+    return solved;
+}
+
+}
+
+//! Run the solver options ask for on problem, stopping when stop asks to
+//! (never if null). stats receives the solver's statistics.
+template<typename Problem>
+bool run_solver(const SolverOptions& options, Problem problem, const StopToken* stop, BuildOrder& result, SearchStatistics& stats)
+{
+    using dispatch_detail::run;
+    // Shares the counters of the copy the solver gets.
+    const Problem observed(problem);
+
+    switch(options.kind)
+    {
+    case SolverKind::ASTAR:
+    {
+        AStarSolver<Problem> solver(std::move(problem));
+        solver.set_dominance_pruning(options.dominance_pruning);
+        solver.set_memory_budget(options.memory_budget);
+        solver.set_bound_callback(options.on_bound);
+        return run(solver, observed, options, stop, result, stats);
+    }
+    case SolverKind::DFBB:
+    {
+        DFBBSolver<Problem> solver(std::move(problem));
+        solver.set_dominance_pruning(options.dominance_pruning);
+        return run(solver, observed, options, stop, result, stats);
+    }
+    case SolverKind::IDA:
+    {
+        IDASolver<Problem> solver(std::move(problem));
+        return run(solver, observed, options, stop, result, stats);
+    }
+    case SolverKind::PARALLEL_DFBB:
+    {
+        ParallelDFBBSolver<Problem> solver(std::move(problem), options.threads);
+        return run(solver, observed, options, stop, result, stats);
+    }
+    case SolverKind::HDASTAR:
+    {
+        HDAStarSolver<Problem> solver(std::move(problem), options.threads);
+        solver.set_memory_budget(options.memory_budget);
+        return run(solver, observed, options, stop, result, stats);
+    }
+    case SolverKind::EXTERNAL_ASTAR:
+    {
+        ExternalAStarSolver<Problem> solver(std::move(problem), options.scratch_directory, options.partitions);
+        solver.set_buffer_size(options.external_buffer);
+        return run(solver, observed, options, stop, result, stats);
+    }
+    case SolverKind::ARASTAR:
+    {
+        ARAStarSolver<Problem> solver(std::move(problem));
+        solver.set_improvement_callback(options.on_improvement);
+        return run(solver, observed, options, stop, result, stats);
+    }
+    }
+    throw std::logic_error("unhandled solver kind");
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef PLANNER_DOMINANCE_HPP
+#define PLANNER_DOMINANCE_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "definitions/hash.hpp"
+#include "solvers/flat_hash.hpp"
+
+//! The structural part of a State: what exists and what is in progress,
+//! but not how far along it is. Only States with equal keys are compared
+//! for dominance.
+struct StructureKey
+{
+    unsigned annexes, depots, foundations, zvs, zps, upgraded_zps;
+    std::uint8_t lc_rps, qp_rps;
+    std::uint8_t foundations_queued, depots_queued, zvs_queued, zps_queued, upgrades_queued;
+
+    explicit StructureKey(const State& s)
+        : annexes(s.annexes)
+        , depots(s.depots)
+        , foundations(s.foundations)
+        , zvs(s.zvs)
+        , zps(s.zps)
+        , upgraded_zps(s.upgraded_zps)
+        , lc_rps(s.lc_rp_state.size())
+        , qp_rps(s.qp_rp_state.size())
+        , foundations_queued(s.foundation_queue.size())
+        , depots_queued(s.depot_queue.size())
+        , zvs_queued(s.zv_queue.size())
+        , zps_queued(s.zp_queue.size())
+        , upgrades_queued(s.zp_upgrade_queue.size())
+    {
+    }
+};
+
+inline bool operator==(const StructureKey& a, const StructureKey& b)
+{
+    return a.annexes == b.annexes && a.depots == b.depots &&
+           a.foundations == b.foundations && a.zvs == b.zvs &&
+           a.zps == b.zps && a.upgraded_zps == b.upgraded_zps &&
+           a.lc_rps == b.lc_rps && a.qp_rps == b.qp_rps &&
+           a.foundations_queued == b.foundations_queued &&
+           a.depots_queued == b.depots_queued &&
+           a.zvs_queued == b.zvs_queued &&
+           a.zps_queued == b.zps_queued &&
+           a.upgrades_queued == b.upgrades_queued;
+}
+
+namespace std {
+    template <> struct hash<StructureKey>
+    {
+        size_t operator()(const StructureKey& k) const
+        {
+            std::size_t seed = 0;
+            hash_combine(seed, k.annexes);
+            hash_combine(seed, k.depots);
+            hash_combine(seed, k.foundations);
+            hash_combine(seed, k.zvs);
+            hash_combine(seed, k.zps);
+            hash_combine(seed, k.upgraded_zps);
+            hash_combine(seed, k.lc_rps);
+            hash_combine(seed, k.qp_rps);
+            hash_combine(seed, k.foundations_queued);
+            hash_combine(seed, k.depots_queued);
+            hash_combine(seed, k.zvs_queued);
+            hash_combine(seed, k.zps_queued);
+            hash_combine(seed, k.upgrades_queued);
+            return seed;
+        }
+    };
+}
+
+template<typename T, std::size_t N>
+bool all_at_least(const FixedVector<T, N>& a, const FixedVector<T, N>& b)
+{
+    return std::equal(a.begin(), a.end(), b.begin(), std::greater_equal<T>());
+}
+
+//! Whether a is at least as good as b: equal structure, at least as many
+//! resources, and every RP and production timer at least as far along.
+//! The timer containers of a State are sorted, so this compares them timer
+//! by timer.
+//!
+//! Timers only count up, so from a every action completes no later than it
+//! would from b, and whatever b can reach a can reach as soon.
+bool dominates(const State& a, const State& b)
+{
+    return a.lc >= b.lc && a.qp >= b.qp &&
+           all_at_least(a.lc_rp_state, b.lc_rp_state) &&
+           all_at_least(a.qp_rp_state, b.qp_rp_state) &&
+           all_at_least(a.foundation_queue, b.foundation_queue) &&
+           all_at_least(a.depot_queue, b.depot_queue) &&
+           all_at_least(a.zv_queue, b.zv_queue) &&
+           all_at_least(a.zp_queue, b.zp_queue) &&
+           all_at_least(a.zp_upgrade_queue, b.zp_upgrade_queue);
+}
+
+//! The nodes a search has seen, grouped by StructureKey, for finding out
+//! whether a new node is dominated by one that is no later. Only nodes not
+//! dominated by another one are kept.
+class DominanceIndex
+{
+public:
+    //! Return true if n is dominated by a node seen before at the same or
+    //! an earlier time. Otherwise remember n, forgetting the nodes it
+    //! dominates in turn, and return false.
+    bool dominated(const Node& n)
+    {
+        const State& s = n.state;
+        assert(is_canonical(s));
+
+        std::pair<std::uint32_t*, bool> group = groups.insert(StructureKey(s), groups_seen.size());
+        if(group.second)
+        {
+            groups_seen.emplace_back();
+        }
+        Group& seen = groups_seen[*group.first];
+
+        // Most candidates fail on time or resources, which are checked
+        // without touching the full States.
+        for(std::size_t i = 0; i < seen.summaries.size(); ++i)
+        {
+            const Summary& e = seen.summaries[i];
+            if(e.t <= n.t && e.lc >= s.lc && e.qp >= s.qp && dominates(seen.states[i], s))
+            {
+                return true;
+            }
+        }
+
+        std::size_t kept = 0;
+        for(std::size_t i = 0; i < seen.summaries.size(); ++i)
+        {
+            const Summary& e = seen.summaries[i];
+            if(!(n.t <= e.t && s.lc >= e.lc && s.qp >= e.qp && dominates(s, seen.states[i])))
+            {
+                if(kept != i)
+                {
+                    seen.summaries[kept] = e;
+                    seen.states[kept] = seen.states[i];
+                }
+                ++kept;
+            }
+        }
+        seen.summaries.resize(kept);
+        seen.states.resize(kept);
+
+        seen.summaries.push_back(Summary {n.t, s.lc, s.qp});
+        seen.states.push_back(s);
+        return false;
+    }
+
+    void clear()
+    {
+        groups.clear();
+        groups_seen.clear();
+    }
+
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for(const Group& seen : groups_seen)
+        {
+            n += seen.states.size();
+        }
+        return n;
+    }
+
+    std::size_t memory_usage() const
+    {
+        std::size_t bytes = groups.memory_usage() + groups_seen.capacity() * sizeof(Group);
+        for(const Group& seen : groups_seen)
+        {
+            bytes += seen.summaries.capacity() * sizeof(Summary) + seen.states.capacity() * sizeof(State);
+        }
+        return bytes;
+    }
+
+private:
+    struct Summary
+    {
+        Time t;
+        Resource lc, qp;
+    };
+
+    //! The undominated nodes with one StructureKey; summaries[i] goes with
+    //! states[i].
+    struct Group
+    {
+        std::vector<Summary> summaries;
+        std::vector<State> states;
+    };
+
+    FlatHashMap<StructureKey, std::uint32_t> groups;
+    std::vector<Group> groups_seen;
+};
+
+#endif
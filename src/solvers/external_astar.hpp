@@ -0,0 +1,811 @@
+#ifndef PLANNER_EXTERNAL_ASTAR_HPP
+#define PLANNER_EXTERNAL_ASTAR_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "definitions/hash.hpp"
+#include "solvers/flat_hash.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+
+//! Bytes read or written per I/O call, and the most a single bucket may
+//! buffer before it is written out.
+constexpr std::size_t EXTERNAL_BLOCK_BYTES = 1 << 20;
+
+//! Default most bytes of successors buffered over all buckets before all
+//! are written out, and most bytes of recently closed States kept in
+//! memory before they are merged into the closed files.
+constexpr std::size_t EXTERNAL_BUFFER_BYTES = 64 << 20;
+
+//! Records per block of a closed file. Looking a State up reads one or two
+//! blocks.
+constexpr std::size_t EXTERNAL_CLOSED_BLOCK = 256;
+
+//! Parent of the start node.
+constexpr std::uint64_t EXTERNAL_NO_PARENT = std::uint64_t(-1);
+
+//! Open list entry as stored on disk: the State, and the action that
+//! reached it from the expanded node numbered parent.
+struct ExternalOpenRecord
+{
+    State state;
+    std::uint64_t parent;
+    Time g;
+    ActionId action;
+};
+
+//! What the trail file keeps of every expanded node, at the position of its
+//! number: enough to follow the path to it back to the start, one record
+//! read per action.
+struct ExternalTrailRecord
+{
+    std::uint64_t parent;
+    ActionId action;
+};
+
+//! Closed list entry as stored on disk, sorted by hash.
+struct ExternalClosedRecord
+{
+    std::uint64_t hash;
+    State state;
+    Time g;
+};
+
+inline std::uint64_t external_hash(const State& s)
+{
+    return mix_hash(std::hash<State>()(s));
+}
+
+//! Reads a file of records front to back, a block at a time.
+template<typename T>
+class RecordReader
+{
+public:
+    explicit RecordReader(const std::string& path)
+        : file(std::fopen(path.c_str(), "rb"))
+        , pos(0)
+    {
+        // A missing file reads as empty.
+    }
+
+    ~RecordReader()
+    {
+        if(file)
+            std::fclose(file);
+    }
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    bool next(T& record)
+    {
+        if(pos == block.size())
+        {
+            if(!refill())
+                return false;
+        }
+        record = block[pos++];
+        return true;
+    }
+
+private:
+    bool refill()
+    {
+        if(!file)
+            return false;
+
+        block.resize(std::max<std::size_t>(1, EXTERNAL_BLOCK_BYTES / sizeof(T)));
+        std::size_t n = std::fread(block.data(), sizeof(T), block.size(), file);
+        if(n < block.size() && std::ferror(file))
+            throw std::runtime_error("reading search file failed");
+        block.resize(n);
+        pos = 0;
+        return n > 0;
+    }
+
+    std::FILE* file;
+    std::vector<T> block;
+    std::size_t pos;
+};
+
+//! Append records to path.
+template<typename T>
+void append_records(const std::string& path, const T* records, std::size_t count)
+{
+    if(count == 0)
+        return;
+
+    std::FILE* file = std::fopen(path.c_str(), "ab");
+    if(!file)
+        throw std::runtime_error("cannot open search file " + path);
+    std::size_t written = std::fwrite(records, sizeof(T), count, file);
+    if(std::fclose(file) != 0 || written != count)
+        throw std::runtime_error("writing search file " + path + " failed");
+}
+
+//! Writes a file of records front to back, a block at a time.
+template<typename T>
+class RecordWriter
+{
+public:
+    explicit RecordWriter(const std::string& path_)
+        : path(path_)
+    {
+        std::remove(path.c_str());
+    }
+
+    void write(const T& record)
+    {
+        block.push_back(record);
+        if(block.size() * sizeof(T) >= EXTERNAL_BLOCK_BYTES)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        append_records(path, block.data(), block.size());
+        block.clear();
+    }
+
+private:
+    std::string path;
+    std::vector<T> block;
+};
+
+//! Create directory path and any missing parents, like mkdir -p. Throws
+//! std::runtime_error if one cannot be created.
+inline void make_directories(const std::string& path)
+{
+    for(std::size_t end = path.find('/', 1); ; end = path.find('/', end + 1))
+    {
+        std::string prefix = path.substr(0, end);
+        if(!prefix.empty() && ::mkdir(prefix.c_str(), 0777) != 0 && errno != EEXIST)
+            throw std::runtime_error("cannot create directory " + prefix + ": " + std::strerror(errno));
+        if(end == std::string::npos)
+            return;
+    }
+}
+
+//! External-memory A*. Open and closed lists live in files in a scratch
+//! directory: open entries in one bucket file per f and hash partition,
+//! closed entries in one file per hash partition, sorted by hash.
+//!
+//! Buckets are expanded in order of f. A bucket is read into memory whole
+//! and sorted by hash, which brings duplicates together. Entries already
+//! closed at no higher g are then dropped: the closed file is indexed by
+//! the first hash of every block, so the lookups of a sorted bucket read
+//! each block they need once, in file order. Newly closed States are kept
+//! in memory and merged into the closed files in one sequential pass when
+//! they fill their buffer. Besides that buffer and those of the bucket
+//! files, only one bucket is in memory at a time; the partition count
+//! decides how big a bucket gets.
+//!
+//! The heuristic must be admissible for optimality.
+template<typename Problem>
+class ExternalAStarSolver
+{
+public:
+    ExternalAStarSolver(Problem&& problem_ = Problem(), std::string scratch_ = "/tmp", unsigned partitions_ = 16)
+        : problem(problem_)
+        , scratch(scratch_)
+        , partitions(partitions_ > 0 ? partitions_ : 1)
+        , buffer_bytes(EXTERNAL_BUFFER_BYTES)
+        , trail_size(0)
+        , stop_token(nullptr)
+        , stopping(false)
+    {
+    }
+
+    bool solve(BuildOrder& result)
+    {
+        stats.start();
+        reporter.restart();
+
+        make_directories(scratch);
+        std::string pattern = scratch + "/baryon-XXXXXX";
+        std::vector<char> dir_name(pattern.begin(), pattern.end());
+        dir_name.push_back('\0');
+        if(!mkdtemp(dir_name.data()))
+            throw std::runtime_error("cannot create a directory in " + scratch + ": " + std::strerror(errno));
+        directory = dir_name.data();
+
+        bool solved;
+        try
+        {
+            solved = search(result);
+        }
+        catch(...)
+        {
+            remove_files();
+            throw;
+        }
+        remove_files();
+
+        snapshot();
+        reporter.finish(stats);
+        return solved;
+    }
+
+    //! Send progress reports to os every interval seconds (never if 0) and
+    //! a final report when the search ends. os may be null to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+    }
+
+    //! Buffer up to bytes of successors, and as many of recently closed
+    //! States, before writing them out.
+    void set_buffer_size(std::size_t bytes)
+    {
+        buffer_bytes = bytes;
+    }
+
+    //! Stop when token asks to (never if null). Like A*, this has no plan
+    //! before it has an optimal one, so a stopped search only proves a
+    //! lower bound: the f it had reached.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
+private:
+    typedef std::pair<Time, unsigned> BucketId;
+
+    bool search(BuildOrder& result)
+    {
+        buffers.clear();
+        buffered_bytes = 0;
+        on_disk.clear();
+        open_count = 0;
+        bucket_bytes = 0;
+        recent_bytes = 0;
+        closed.clear();
+        closed.resize(partitions);
+        stopping = false;
+
+        Node start = problem.start_node();
+        trail.reset(new RecordWriter<ExternalTrailRecord>(trail_path()));
+        trail_size = 0;
+
+        ExternalOpenRecord first;
+        first.state = start.state;
+        first.parent = EXTERNAL_NO_PARENT;
+        first.g = start.t;
+        first.action = ActionId();
+        add(first, start.t + timed_heuristic(problem, start, stats), start.t);
+
+        while(!buffers.empty() || !on_disk.empty())
+        {
+            Time f = lowest_f();
+            stats.set_f_bound(f);
+            stats.lower_bound = f;
+
+            // Expanding a bucket can add to any bucket of the same f,
+            // including ones done already.
+            while(true)
+            {
+                unsigned p;
+                if(!next_partition(f, p))
+                    break;
+
+                ExternalOpenRecord goal;
+                if(expand_bucket(BucketId(f, p), goal))
+                {
+                    result = replay_solution(start, trace_actions(goal));
+                    assert(result.back().state == goal.state);
+                    stats.lower_bound = result.back().t;
+                    return true;
+                }
+                if(stopping)
+                {
+                    stats.stopped = true;
+                    return false;
+                }
+            }
+        }
+        return false;
+    }
+
+    unsigned partition_of(const State& s) const
+    {
+        return (external_hash(s) >> 32) % partitions;
+    }
+
+    std::string open_path(const BucketId& b) const
+    {
+        return directory + "/open-" + std::to_string(b.first) + "-" + std::to_string(b.second);
+    }
+
+    std::string closed_path(unsigned p) const
+    {
+        return directory + "/closed-" + std::to_string(p);
+    }
+
+    std::string trail_path() const
+    {
+        return directory + "/trail";
+    }
+
+    //! Follow parent links from r back to the start through the trail file
+    //! and return the actions in order.
+    std::vector<ActionId> trace_actions(const ExternalOpenRecord& r)
+    {
+        std::vector<ActionId> actions;
+        if(r.parent == EXTERNAL_NO_PARENT)
+            return actions;
+        actions.push_back(r.action);
+
+        trail->flush();
+        std::string path = trail_path();
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if(!file)
+            throw std::runtime_error("cannot open search file " + path);
+        for(std::uint64_t i = r.parent; ; )
+        {
+            ExternalTrailRecord t;
+            if(std::fseek(file, long(i * sizeof(ExternalTrailRecord)), SEEK_SET) != 0 ||
+               std::fread(&t, sizeof(t), 1, file) != 1)
+            {
+                std::fclose(file);
+                throw std::runtime_error("reading search file failed");
+            }
+            if(t.parent == EXTERNAL_NO_PARENT)
+                break;
+            actions.push_back(t.action);
+            i = t.parent;
+        }
+        std::fclose(file);
+        std::reverse(actions.begin(), actions.end());
+        return actions;
+    }
+
+    //! Put r on the open list with priority f, but never below the f being
+    //! expanded: an inconsistent heuristic can give successors a lower f,
+    //! and the layers before are finished.
+    void add(const ExternalOpenRecord& r, Time f, Time current_f)
+    {
+        BucketId b(std::max(f, current_f), partition_of(r.state));
+        std::vector<ExternalOpenRecord>& buffer = buffers[b];
+        buffer.push_back(r);
+        buffered_bytes += sizeof(ExternalOpenRecord);
+        ++open_count;
+
+        if(buffer.size() * sizeof(ExternalOpenRecord) >= EXTERNAL_BLOCK_BYTES)
+        {
+            write_out(b, buffer);
+            buffers.erase(b);
+        }
+        if(buffered_bytes >= buffer_bytes)
+        {
+            for(auto& entry : buffers)
+            {
+                write_out(entry.first, entry.second);
+            }
+            buffers.clear();
+        }
+    }
+
+    void write_out(const BucketId& b, const std::vector<ExternalOpenRecord>& buffer)
+    {
+        append_records(open_path(b), buffer.data(), buffer.size());
+        buffered_bytes -= buffer.size() * sizeof(ExternalOpenRecord);
+        on_disk.insert(b);
+    }
+
+    Time lowest_f() const
+    {
+        Time f = NEVER;
+        if(!buffers.empty())
+        {
+            f = buffers.begin()->first.first;
+        }
+        if(!on_disk.empty())
+        {
+            f = std::min(f, on_disk.begin()->first);
+        }
+        return f;
+    }
+
+    //! Find a non-empty bucket of layer f.
+    bool next_partition(Time f, unsigned& p)
+    {
+        auto disk = on_disk.lower_bound(BucketId(f, 0));
+        if(disk != on_disk.end() && disk->first == f)
+        {
+            p = disk->second;
+            return true;
+        }
+        auto buffered = buffers.lower_bound(BucketId(f, 0));
+        if(buffered != buffers.end() && buffered->first.first == f)
+        {
+            p = buffered->first.second;
+            return true;
+        }
+        return false;
+    }
+
+    //! Read bucket b into memory, removing it from the open list.
+    std::vector<ExternalOpenRecord> take_bucket(const BucketId& b)
+    {
+        std::vector<ExternalOpenRecord> bucket;
+        if(on_disk.erase(b))
+        {
+            RecordReader<ExternalOpenRecord> reader(open_path(b));
+            ExternalOpenRecord r;
+            while(reader.next(r))
+            {
+                bucket.push_back(r);
+            }
+            std::remove(open_path(b).c_str());
+        }
+
+        auto buffered = buffers.find(b);
+        if(buffered != buffers.end())
+        {
+            bucket.insert(bucket.end(), buffered->second.begin(), buffered->second.end());
+            buffered_bytes -= buffered->second.size() * sizeof(ExternalOpenRecord);
+            buffers.erase(buffered);
+        }
+        open_count -= bucket.size();
+        return bucket;
+    }
+
+    //! Expand bucket b. Return true and set goal if it holds a goal.
+    bool expand_bucket(const BucketId& b, ExternalOpenRecord& goal)
+    {
+        std::vector<ExternalOpenRecord> bucket = take_bucket(b);
+        bucket_bytes = bucket.capacity() * sizeof(ExternalOpenRecord);
+
+        // Sort by hash, then g, so that the cheapest copy of each State
+        // comes first among its duplicates.
+        std::vector<std::pair<std::uint64_t, std::uint32_t>> order;
+        order.reserve(bucket.size());
+        for(std::size_t i = 0; i < bucket.size(); ++i)
+        {
+            order.emplace_back(external_hash(bucket[i].state), i);
+        }
+        std::sort(order.begin(), order.end(), [&bucket](const std::pair<std::uint64_t, std::uint32_t>& a,
+                                                        const std::pair<std::uint64_t, std::uint32_t>& b) {
+            return a.first < b.first || (a.first == b.first && bucket[a.second].g < bucket[b.second].g);
+        });
+
+        std::vector<std::uint32_t> survivors = filter_closed(b.second, bucket, order);
+
+        for(std::uint32_t i : survivors)
+        {
+            const ExternalOpenRecord& r = bucket[i];
+            Node n;
+            n.t = r.g;
+            n.state = r.state;
+            if(problem.is_goal(n))
+            {
+                goal = r;
+                return true;
+            }
+        }
+
+        for(std::uint32_t i : survivors)
+        {
+            const ExternalOpenRecord& r = bucket[i];
+            Node n;
+            n.t = r.g;
+            n.state = r.state;
+
+            ++stats.expanded;
+            std::uint64_t id = trail_size++;
+            trail->write(ExternalTrailRecord {r.parent, r.action});
+            problem.visit_neighbors(n, [this, id, &b](Node&& succ) {
+                ++stats.generated;
+                ExternalOpenRecord child;
+                child.state = succ.state;
+                child.parent = id;
+                child.g = succ.t;
+                child.action = succ.action.id;
+                add(child, succ.t + timed_heuristic(problem, succ, stats), b.first);
+            });
+
+            if(reporter.due())
+            {
+                snapshot();
+                reporter.progress(stats);
+            }
+            if(should_stop(stop_token, stats.expanded))
+            {
+                stopping = true;
+                return false;
+            }
+        }
+        return false;
+    }
+
+    //! Closed States of one hash partition: a file sorted by hash with the
+    //! first hash of each block, and the States closed since it was written.
+    struct ClosedPartition
+    {
+        ClosedPartition()
+            : file_size(0)
+            , recent(1 << 8)
+        {
+        }
+
+        std::vector<std::uint64_t> block_starts;
+        std::size_t file_size;
+        FlatHashMap<State, Time> recent;
+    };
+
+    //! Random access to the blocks of a closed file, one block at a time.
+    class ClosedFileCursor
+    {
+    public:
+        ClosedFileCursor(const std::string& path, const ClosedPartition& partition_)
+            : file(partition_.file_size > 0 ? std::fopen(path.c_str(), "rb") : nullptr)
+            , partition(partition_)
+            , loaded(NONE)
+        {
+            if(partition.file_size > 0 && !file)
+                throw std::runtime_error("cannot open search file " + path);
+        }
+
+        ~ClosedFileCursor()
+        {
+            if(file)
+                std::fclose(file);
+        }
+
+        ClosedFileCursor(const ClosedFileCursor&) = delete;
+        ClosedFileCursor& operator=(const ClosedFileCursor&) = delete;
+
+        //! Return the g s was closed at, or NEVER.
+        Time find(const State& s, std::uint64_t h)
+        {
+            const std::vector<std::uint64_t>& starts = partition.block_starts;
+            std::size_t i = std::lower_bound(starts.begin(), starts.end(), h) - starts.begin();
+            // Records with hash h may start in the block before.
+            for(i = i > 0 ? i - 1 : 0; i < starts.size() && starts[i] <= h; ++i)
+            {
+                load(i);
+                for(const ExternalClosedRecord& r : block)
+                {
+                    if(r.hash == h && r.state == s)
+                        return r.g;
+                    if(r.hash > h)
+                        return NEVER;
+                }
+            }
+            return NEVER;
+        }
+
+    private:
+        static constexpr std::size_t NONE = std::size_t(-1);
+
+        void load(std::size_t i)
+        {
+            if(loaded == i)
+                return;
+
+            std::size_t first = i * EXTERNAL_CLOSED_BLOCK;
+            block.resize(std::min(EXTERNAL_CLOSED_BLOCK, partition.file_size - first));
+            if(std::fseek(file, long(first * sizeof(ExternalClosedRecord)), SEEK_SET) != 0 ||
+               std::fread(block.data(), sizeof(ExternalClosedRecord), block.size(), file) != block.size())
+            {
+                throw std::runtime_error("reading search file failed");
+            }
+            loaded = i;
+        }
+
+        std::FILE* file;
+        const ClosedPartition& partition;
+        std::vector<ExternalClosedRecord> block;
+        std::size_t loaded;
+    };
+
+    //! Return the indices (in hash order) of the bucket entries to expand:
+    //! the cheapest copy of each State, unless it was closed at no higher
+    //! g. They are closed now.
+    std::vector<std::uint32_t> filter_closed(unsigned p, const std::vector<ExternalOpenRecord>& bucket,
+                                             const std::vector<std::pair<std::uint64_t, std::uint32_t>>& order)
+    {
+        ClosedPartition& partition = closed[p];
+        ClosedFileCursor cursor(closed_path(p), partition);
+
+        std::vector<std::uint32_t> survivors;
+        for(const std::pair<std::uint64_t, std::uint32_t>& o : order)
+        {
+            const ExternalOpenRecord& r = bucket[o.second];
+            std::pair<Time*, bool> recent = partition.recent.insert(r.state, r.g);
+            if(recent.second)
+            {
+                Time g = cursor.find(r.state, o.first);
+                if(g != NEVER && g <= r.g)
+                {
+                    *recent.first = g;
+                    ++stats.duplicates;
+                    continue;
+                }
+            }
+            else if(r.g < *recent.first)
+            {
+                // Reached more cheaply than when it was closed: reopen.
+                *recent.first = r.g;
+            }
+            else
+            {
+                ++stats.duplicates;
+                continue;
+            }
+            survivors.push_back(o.second);
+        }
+
+        recent_bytes = 0;
+        for(const ClosedPartition& c : closed)
+        {
+            recent_bytes += c.recent.memory_usage();
+        }
+        if(recent_bytes >= buffer_bytes)
+        {
+            for(unsigned q = 0; q < partitions; ++q)
+            {
+                merge_recent(q);
+            }
+            recent_bytes = 0;
+        }
+        return survivors;
+    }
+
+    //! Write the recently closed States of partition p into its file, in
+    //! one pass over the old file.
+    void merge_recent(unsigned p)
+    {
+        ClosedPartition& partition = closed[p];
+        // Nothing to write, and a partition that never had any has no file
+        // to replace.
+        if(partition.recent.size() == 0)
+            return;
+
+        std::vector<ExternalClosedRecord> recent;
+        recent.reserve(partition.recent.size());
+        partition.recent.for_each([&recent](const State& s, Time g) {
+            recent.push_back(ExternalClosedRecord {external_hash(s), s, g});
+        });
+        std::sort(recent.begin(), recent.end(), [](const ExternalClosedRecord& a, const ExternalClosedRecord& b) {
+            return a.hash < b.hash;
+        });
+
+        std::string path = closed_path(p);
+        std::string new_path = path + ".new";
+        std::vector<std::uint64_t> block_starts;
+        std::size_t size = 0;
+        {
+            RecordReader<ExternalClosedRecord> reader(path);
+            RecordWriter<ExternalClosedRecord> writer(new_path);
+            auto write = [&writer, &block_starts, &size](const ExternalClosedRecord& r) {
+                if(size % EXTERNAL_CLOSED_BLOCK == 0)
+                {
+                    block_starts.push_back(r.hash);
+                }
+                writer.write(r);
+                ++size;
+            };
+
+            ExternalClosedRecord old;
+            bool have_old = reader.next(old);
+            for(const ExternalClosedRecord& r : recent)
+            {
+                while(have_old && old.hash < r.hash)
+                {
+                    write(old);
+                    have_old = reader.next(old);
+                }
+                // States reopened since have a lower g than their old
+                // record, which is dropped.
+                while(have_old && old.hash == r.hash)
+                {
+                    if(!(old.state == r.state))
+                    {
+                        write(old);
+                    }
+                    have_old = reader.next(old);
+                }
+                write(r);
+            }
+            while(have_old)
+            {
+                write(old);
+                have_old = reader.next(old);
+            }
+            writer.flush();
+        }
+
+        if(std::rename(new_path.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("replacing " + path + " failed");
+        partition.block_starts.swap(block_starts);
+        partition.file_size = size;
+        partition.recent = FlatHashMap<State, Time>(1 << 8);
+    }
+
+    void snapshot()
+    {
+        stats.open_size = open_count;
+        stats.closed_size = 0;
+        std::size_t index_bytes = 0;
+        for(const ClosedPartition& c : closed)
+        {
+            stats.closed_size += c.file_size + c.recent.size();
+            index_bytes += c.block_starts.capacity() * sizeof(std::uint64_t);
+        }
+        // Only what is in memory; the lists themselves are on disk.
+        stats.memory_bytes = buffered_bytes + bucket_bytes + recent_bytes + index_bytes;
+    }
+
+    void remove_files()
+    {
+        for(const BucketId& b : on_disk)
+        {
+            std::remove(open_path(b).c_str());
+        }
+        on_disk.clear();
+        for(unsigned p = 0; p < partitions; ++p)
+        {
+            std::remove(closed_path(p).c_str());
+            std::remove((closed_path(p) + ".new").c_str());
+        }
+        std::remove(trail_path().c_str());
+        rmdir(directory.c_str());
+    }
+
+    Problem problem;
+    std::string scratch;
+    unsigned partitions;
+    std::size_t buffer_bytes;
+    std::string directory;
+
+    //! Successors not yet written to their bucket files. Buckets without
+    //! any have no entry.
+    std::map<BucketId, std::vector<ExternalOpenRecord>> buffers;
+    std::size_t buffered_bytes;
+    //! Buckets with a file.
+    std::set<BucketId> on_disk;
+
+    std::size_t open_count;
+    std::size_t bucket_bytes;
+
+    std::vector<ClosedPartition> closed;
+    std::size_t recent_bytes;
+
+    //! The expanded nodes, by number.
+    std::unique_ptr<RecordWriter<ExternalTrailRecord>> trail;
+    std::uint64_t trail_size;
+
+    const StopToken* stop_token;
+    bool stopping;
+
+    SearchStatistics stats;
+    StatisticsReporter reporter;
+};
+
+#endif
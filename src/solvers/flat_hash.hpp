@@ -0,0 +1,240 @@
+#ifndef PLANNER_FLAT_HASH_HPP
+#define PLANNER_FLAT_HASH_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "definitions/hash.hpp"
+
+//! Bytes that extra more push_backs onto v may allocate: a new array, while
+//! the old one is still live, if they outgrow its capacity.
+template<typename T>
+std::size_t vector_growth(const std::vector<T>& v, std::size_t extra)
+{
+    if(v.size() + extra <= v.capacity())
+        return 0;
+    return std::max(v.capacity() * 2, v.size() + extra) * sizeof(T);
+}
+
+//! Insert-only hash map using linear probing over a flat slot array.
+//! Slots hold a 32-bit fingerprint and the index of the entry in dense key
+//! and value arrays, so probing touches 8 bytes per slot and growing the
+//! table never moves the entries themselves.
+//!
+//! Pointers returned by find() and insert() are invalidated by the next
+//! insertion.
+template<typename K, typename V, typename Hash = std::hash<K>>
+class FlatHashMap
+{
+public:
+    explicit FlatHashMap(std::size_t expected_size = 1 << 16)
+    {
+        reserve(expected_size);
+    }
+
+    //! Make room for n entries without rehashing.
+    void reserve(std::size_t n)
+    {
+        std::size_t wanted = 16;
+        while(wanted * MAX_LOAD_NUM < n * MAX_LOAD_DEN)
+        {
+            wanted *= 2;
+        }
+        if(wanted > slots.size())
+        {
+            rehash(wanted);
+        }
+        keys.reserve(n);
+        values.reserve(n);
+    }
+
+    //! Insert k -> v unless k is already present. Returns the value now
+    //! mapped to k and whether an insertion took place.
+    std::pair<V*, bool> insert(const K& k, const V& v)
+    {
+        if((keys.size() + 1) * MAX_LOAD_DEN > slots.size() * MAX_LOAD_NUM)
+        {
+            rehash(slots.size() * 2);
+        }
+
+        std::uint32_t tag = fingerprint(k);
+        std::size_t i = find_slot(k, tag);
+        if(slots[i].tag != EMPTY)
+        {
+            return std::make_pair(&values[slots[i].index], false);
+        }
+
+        assert(keys.size() < UINT32_MAX);
+        slots[i].tag = tag;
+        slots[i].index = static_cast<std::uint32_t>(keys.size());
+        keys.push_back(k);
+        values.push_back(v);
+        return std::make_pair(&values.back(), true);
+    }
+
+    V* find(const K& k)
+    {
+        const Slot& s = slots[find_slot(k, fingerprint(k))];
+        return s.tag != EMPTY ? &values[s.index] : nullptr;
+    }
+
+    const V* find(const K& k) const
+    {
+        const Slot& s = slots[find_slot(k, fingerprint(k))];
+        return s.tag != EMPTY ? &values[s.index] : nullptr;
+    }
+
+    std::size_t count(const K& k) const
+    {
+        return find(k) != nullptr ? 1 : 0;
+    }
+
+    //! Call f(key, value) for every entry, in insertion order.
+    template<typename F>
+    void for_each(F f) const
+    {
+        for(std::size_t i = 0; i < keys.size(); ++i)
+        {
+            f(keys[i], values[i]);
+        }
+    }
+
+    std::size_t size() const { return keys.size(); }
+    bool empty() const { return keys.empty(); }
+    std::size_t bucket_count() const { return slots.size(); }
+    float load_factor() const { return static_cast<float>(keys.size()) / slots.size(); }
+
+    //! Approximate heap footprint of the table.
+    std::size_t memory_usage() const
+    {
+        return slots.capacity() * sizeof(Slot) +
+               keys.capacity() * sizeof(K) +
+               values.capacity() * sizeof(V);
+    }
+
+    //! Bytes that extra more insertions may allocate on top of
+    //! memory_usage(). Growing allocates new arrays while the old ones are
+    //! still live.
+    std::size_t growth_memory(std::size_t extra) const
+    {
+        std::size_t bytes = vector_growth(keys, extra) + vector_growth(values, extra);
+        std::size_t n = slots.size();
+        while((keys.size() + extra) * MAX_LOAD_DEN > n * MAX_LOAD_NUM)
+        {
+            n *= 2;
+        }
+        if(n > slots.size())
+        {
+            bytes += n * sizeof(Slot);
+        }
+        return bytes;
+    }
+
+    void clear()
+    {
+        keys.clear();
+        values.clear();
+        std::fill(slots.begin(), slots.end(), Slot());
+    }
+
+private:
+    struct Slot
+    {
+        std::uint32_t tag = EMPTY;
+        std::uint32_t index = 0;
+    };
+
+    static constexpr std::uint32_t EMPTY = 0;
+    static constexpr std::size_t MAX_LOAD_NUM = 7;
+    static constexpr std::size_t MAX_LOAD_DEN = 10;
+
+    //! High bits of the mixed hash. The lowest bit is always set, which
+    //! reserves 0 for empty slots; the rest also pick the home slot, so
+    //! rehashing never has to hash the keys again.
+    std::uint32_t fingerprint(const K& k) const
+    {
+        return static_cast<std::uint32_t>(mix_hash(hasher(k)) >> 32) | 1;
+    }
+
+    std::size_t home_slot(std::uint32_t tag) const
+    {
+        return (tag >> 1) & (slots.size() - 1);
+    }
+
+    //! Return the slot holding k, or the empty slot where it would go.
+    std::size_t find_slot(const K& k, std::uint32_t tag) const
+    {
+        std::size_t mask = slots.size() - 1;
+        for(std::size_t i = home_slot(tag); ; i = (i + 1) & mask)
+        {
+            const Slot& s = slots[i];
+            if(s.tag == EMPTY || (s.tag == tag && keys[s.index] == k))
+            {
+                return i;
+            }
+        }
+    }
+
+    void rehash(std::size_t new_size)
+    {
+        assert((new_size & (new_size - 1)) == 0);
+        assert(new_size <= (std::size_t(1) << 31));
+        std::vector<Slot> old(new_size);
+        old.swap(slots);
+
+        std::size_t mask = slots.size() - 1;
+        for(const Slot& s : old)
+        {
+            if(s.tag == EMPTY)
+                continue;
+
+            std::size_t i = home_slot(s.tag);
+            while(slots[i].tag != EMPTY)
+            {
+                i = (i + 1) & mask;
+            }
+            slots[i] = s;
+        }
+    }
+
+    Hash hasher;
+    std::vector<Slot> slots;
+    std::vector<K> keys;
+    std::vector<V> values;
+};
+
+//! Insert-only hash set on top of FlatHashMap.
+template<typename T, typename Hash = std::hash<T>>
+class FlatHashSet
+{
+public:
+    explicit FlatHashSet(std::size_t expected_size = 1 << 16)
+        : map(expected_size)
+    {
+    }
+
+    void reserve(std::size_t n) { map.reserve(n); }
+
+    //! Insert v, returning false if an equal value was already present.
+    bool insert(const T& v) { return map.insert(v, Present()).second; }
+
+    std::size_t count(const T& v) const { return map.count(v); }
+    std::size_t size() const { return map.size(); }
+    bool empty() const { return map.empty(); }
+    std::size_t bucket_count() const { return map.bucket_count(); }
+    float load_factor() const { return map.load_factor(); }
+    std::size_t memory_usage() const { return map.memory_usage(); }
+    void clear() { map.clear(); }
+
+private:
+    struct Present {};
+
+    FlatHashMap<T, Present, Hash> map;
+};
+
+#endif
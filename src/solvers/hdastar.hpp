@@ -0,0 +1,597 @@
+#ifndef PLANNER_HDASTAR_HPP
+#define PLANNER_HDASTAR_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "solvers/astar.hpp"
+#include "solvers/flat_hash.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+
+//! Successor generated by one worker and owned by another.
+struct HdaMessage
+{
+    Node node;
+    Time h;
+    std::uint32_t parent_record;
+    std::uint16_t parent_worker;
+    unsigned int depth;
+};
+
+//! Search record whose parent may belong to a different worker.
+struct HdaRecord
+{
+    std::uint32_t parent;
+    std::uint16_t parent_worker;
+    ActionId action;
+};
+
+//! Multiple-producer, single-consumer inbox of message batches. Producers
+//! push with a CAS; the owner takes the whole list at once, so there is
+//! no ABA problem.
+class HdaInbox
+{
+public:
+    struct Batch
+    {
+        std::vector<HdaMessage> messages;
+        Batch* next = nullptr;
+    };
+
+    HdaInbox() : head(nullptr) {}
+
+    ~HdaInbox()
+    {
+        for(Batch* b = take_all(); b != nullptr; )
+        {
+            Batch* next = b->next;
+            delete b;
+            b = next;
+        }
+    }
+
+    void push(Batch* b)
+    {
+        b->next = head.load(std::memory_order_relaxed);
+        while(!head.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    bool has_messages() const
+    {
+        return head.load(std::memory_order_acquire) != nullptr;
+    }
+
+    Batch* take_all()
+    {
+        return head.exchange(nullptr, std::memory_order_acquire);
+    }
+
+private:
+    std::atomic<Batch*> head;
+};
+
+//! Successors are buffered per owner and sent once this many accumulate.
+constexpr std::size_t HDA_BATCH_SIZE = 64;
+
+//! Hash-distributed A*. Every State has an owning worker picked by its
+//! hash; only the owner keeps it in its open list and closed map, so the
+//! workers share nothing but their inboxes.
+//!
+//! Expansion order is only approximately best-first across workers, so a
+//! state can be reached again with a lower g after it was expanded; the
+//! closed map keeps the best g and such states are reopened. A goal only
+//! becomes the incumbent, and the search runs until no worker holds a
+//! node with f below it and no messages are in flight. With an admissible
+//! heuristic the incumbent is then optimal.
+//!
+//! With a memory budget, a worker that would outgrow its share stops the
+//! search and IDA* finishes it from the lowest f still open, like A* does.
+template<typename Problem>
+class HDAStarSolver
+{
+public:
+    HDAStarSolver(Problem&& problem_ = Problem(), unsigned num_threads_ = std::thread::hardware_concurrency())
+        : problem(problem_)
+        , num_threads(num_threads_ > 0 ? num_threads_ : 1)
+        , memory_budget(0)
+        , stop_token(nullptr)
+    {
+        assert(num_threads <= std::numeric_limits<std::uint16_t>::max());
+    }
+
+    bool solve(BuildOrder& result)
+    {
+        stats.start();
+        reporter.restart();
+        shared_stats.reset(num_threads);
+
+        Node start = problem.start_node();
+
+        incumbent = std::numeric_limits<Time>::max();
+        best_goal_worker = 0;
+        best_goal_record = NO_PARENT;
+        work = num_threads;
+        stopping = false;
+        over_budget = false;
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        for(unsigned i = 0; i < num_threads; ++i)
+        {
+            workers.emplace_back(new Worker(*this, i));
+        }
+
+        Time start_h = timed_heuristic(problem, start, stats);
+        workers[owner(start.state)]->accept(HdaMessage {start, start_h, NO_PARENT, 0, 0});
+
+        std::vector<std::thread> threads;
+        for(unsigned i = 1; i < num_threads; ++i)
+        {
+            threads.emplace_back(&Worker::run, workers[i].get());
+        }
+        workers[0]->run();
+        for(std::thread& t : threads)
+        {
+            t.join();
+        }
+
+        stats.lower_bound = incumbent;
+        if(stopping)
+        {
+            // Some node on an optimal path is still open or in flight, with
+            // its optimal g. Move the messages in flight to open lists.
+            for(const auto& w : workers)
+            {
+                w->receive();
+            }
+            for(const auto& w : workers)
+            {
+                stats.lower_bound = std::min(stats.lower_bound, w->min_f());
+            }
+            stats.stopped = true;
+        }
+
+        for(const auto& w : workers)
+        {
+            w->snapshot();
+            stats.merge(w->stats);
+        }
+        if(incumbent != std::numeric_limits<Time>::max())
+        {
+            stats.set_f_bound(incumbent);
+        }
+
+        BuildOrder found;
+        if(best_goal_record != NO_PARENT)
+        {
+            found = incumbent_plan(start, workers);
+        }
+
+        if(over_budget && stats.lower_bound < incumbent)
+        {
+            // The incumbent, if any, is not proven optimal yet.
+            workers.clear();
+            stats.stopped = false;
+            reporter.handover(stats);
+            return finish_with_ida(found, result);
+        }
+        reporter.finish(stats);
+
+        if(found.empty())
+        {
+            return false;
+        }
+        result = std::move(found);
+        return true;
+    }
+
+    //! Send progress reports to os every interval seconds (never if 0) and
+    //! a final report when the search ends. os may be null to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+        report_interval = interval;
+    }
+
+    //! Once a worker uses more than its share of bytes (0 for no limit),
+    //! drop everything and let IDA* finish from the lowest f left open.
+    //! The result is still optimal.
+    void set_memory_budget(std::size_t bytes)
+    {
+        memory_budget = bytes;
+    }
+
+    //! Stop when token asks to (never if null), with the best plan found
+    //! so far. Any worker that notices stops all of them.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
+private:
+    struct Worker;
+
+    //! The plan to the incumbent goal, from the records of workers.
+    BuildOrder incumbent_plan(const Node& start, const std::vector<std::unique_ptr<Worker>>& workers) const
+    {
+        std::vector<ActionId> actions;
+        std::uint16_t w = best_goal_worker;
+        for(std::uint32_t i = best_goal_record; workers[w]->records[i].parent != NO_PARENT; )
+        {
+            const HdaRecord& r = workers[w]->records[i];
+            actions.push_back(r.action);
+            i = r.parent;
+            w = r.parent_worker;
+        }
+        std::reverse(actions.begin(), actions.end());
+
+        BuildOrder plan = replay_solution(start, actions);
+        assert(plan.back().t == incumbent);
+        return plan;
+    }
+
+    struct Worker
+    {
+        Worker(HDAStarSolver& solver_, unsigned id_)
+            : solver(solver_)
+            , problem(solver_.problem)
+            , id(id_)
+            , outgoing(solver_.num_threads)
+            , publish_timer(nullptr, solver_.report_interval)
+        {
+        }
+
+        //! Add a node owned by this worker to the open list, unless a path
+        //! at least as cheap is already known.
+        bool accept(const HdaMessage& m)
+        {
+            Time g = m.node.t;
+            if(g + m.h >= solver.incumbent.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            const Time* best_g = closed.find(m.node.state);
+            if(best_g != nullptr && *best_g <= g)
+            {
+                ++stats.duplicates;
+                return false;
+            }
+
+            assert(records.size() < NO_PARENT);
+            records.push_back(HdaRecord {m.parent_record, m.parent_worker, m.node.action.id});
+            open.push(AstarNode {g + m.h, m.h, g, std::uint32_t(records.size() - 1), frontier.store(m.node), m.depth});
+            return true;
+        }
+
+        //! Take everything from the inbox. Returns whether anything arrived.
+        bool receive()
+        {
+            HdaInbox::Batch* b = solver.inboxes[id].take_all();
+            if(b == nullptr)
+            {
+                return false;
+            }
+
+            long received = 0;
+            while(b != nullptr)
+            {
+                for(const HdaMessage& m : b->messages)
+                {
+                    accept(m);
+                    ++received;
+                }
+                HdaInbox::Batch* next = b->next;
+                delete b;
+                b = next;
+            }
+            // Only now are the messages off the books; they are in our open list.
+            solver.work.fetch_sub(received, std::memory_order_acq_rel);
+            return true;
+        }
+
+        void send(unsigned to)
+        {
+            std::vector<HdaMessage>& buffer = outgoing[to];
+            if(buffer.empty())
+                return;
+
+            // Count the messages before they become visible to the receiver.
+            solver.work.fetch_add(buffer.size(), std::memory_order_acq_rel);
+            HdaInbox::Batch* b = new HdaInbox::Batch;
+            b->messages.swap(buffer);
+            solver.inboxes[to].push(b);
+        }
+
+        void flush()
+        {
+            for(unsigned to = 0; to < outgoing.size(); ++to)
+            {
+                send(to);
+            }
+        }
+
+        void expand(const AstarNode& node, const Node& n)
+        {
+            ++stats.expanded;
+            problem.visit_neighbors(n, [this, &node](Node&& succ) {
+                ++stats.generated;
+                Time h = timed_heuristic(problem, succ, stats);
+                if(succ.t + h >= solver.incumbent.load(std::memory_order_relaxed))
+                    return;
+
+                succ.predecessor = nullptr;
+                HdaMessage m {succ, h, node.record, std::uint16_t(id), node.depth + 1};
+                unsigned to = solver.owner(succ.state);
+                if(to == id)
+                {
+                    accept(m);
+                }
+                else
+                {
+                    outgoing[to].push_back(m);
+                    if(outgoing[to].size() >= HDA_BATCH_SIZE)
+                    {
+                        send(to);
+                    }
+                }
+            });
+        }
+
+        void report_goal(const AstarNode& node)
+        {
+            std::lock_guard<std::mutex> lock(solver.goal_mutex);
+            if(node.g < solver.incumbent.load(std::memory_order_relaxed))
+            {
+                solver.incumbent.store(node.g, std::memory_order_relaxed);
+                solver.best_goal_worker = id;
+                solver.best_goal_record = node.record;
+            }
+        }
+
+        void run()
+        {
+            bool active = true;
+            while(true)
+            {
+                if(solver.stopping.load(std::memory_order_relaxed))
+                    return;
+
+                if(active)
+                {
+                    receive();
+                }
+
+                if(!open.empty() && open.top().f < solver.incumbent.load(std::memory_order_relaxed))
+                {
+                    AstarNode node = open.top();
+                    open.pop();
+                    Node n = frontier.take(node.slot);
+
+                    std::pair<Time*, bool> r = closed.insert(n.state, node.g);
+                    if(!r.second)
+                    {
+                        if(*r.first <= node.g)
+                        {
+                            ++stats.duplicates;
+                            continue;
+                        }
+                        *r.first = node.g; // Reopen: reached with a cheaper path.
+                    }
+
+                    if(problem.is_goal(n))
+                    {
+                        report_goal(node);
+                    }
+                    else
+                    {
+                        expand(node, n);
+                        if(should_stop(solver.stop_token, stats.expanded))
+                        {
+                            solver.stopping.store(true, std::memory_order_relaxed);
+                        }
+                        if(over_budget())
+                        {
+                            solver.over_budget.store(true, std::memory_order_relaxed);
+                            solver.stopping.store(true, std::memory_order_relaxed);
+                        }
+                    }
+
+                    if(publish_timer.due())
+                    {
+                        publish();
+                    }
+                    continue;
+                }
+
+                // Nothing useful left locally; everything on the open list
+                // is pruned by the incumbent.
+                while(!open.empty())
+                {
+                    frontier.take(open.top().slot);
+                    open.pop();
+                }
+
+                if(active)
+                {
+                    flush();
+                    active = false;
+                    solver.work.fetch_sub(1, std::memory_order_acq_rel);
+                }
+
+                if(solver.inboxes[id].has_messages())
+                {
+                    // The pending messages keep work above zero until
+                    // receive() has put them on our open list, so becoming
+                    // active here cannot race with termination.
+                    solver.work.fetch_add(1, std::memory_order_acq_rel);
+                    active = true;
+                    continue;
+                }
+                if(solver.work.load(std::memory_order_acquire) == 0)
+                {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        //! The lowest f of the nodes in the open list or waiting to be
+        //! sent.
+        Time min_f()
+        {
+            Time f = open.empty() ? std::numeric_limits<Time>::max() : open.top().f;
+            for(const std::vector<HdaMessage>& buffer : outgoing)
+            {
+                for(const HdaMessage& m : buffer)
+                {
+                    f = std::min(f, m.node.t + m.h);
+                }
+            }
+            return f;
+        }
+
+        //! Whether this worker's next expansions could take it past its
+        //! share of the budget. The workers split MEMORY_CHECK_PERIOD
+        //! between them, and each one receives about as many successors as
+        //! it generates.
+        bool over_budget()
+        {
+            std::size_t period = std::max<std::size_t>(MEMORY_CHECK_PERIOD / solver.num_threads, 1);
+            if(solver.memory_budget == 0 || stats.expanded % period != 0)
+                return false;
+
+            snapshot();
+            std::size_t extra = period * NUM_ACTIONS;
+            std::size_t projected = stats.memory_bytes +
+                                    vector_growth(records, extra) +
+                                    frontier.growth_memory(extra) +
+                                    closed.growth_memory(extra) +
+                                    extra * (sizeof(AstarNode) + sizeof(HdaMessage));
+            return projected > solver.memory_budget / solver.num_threads;
+        }
+
+        void snapshot()
+        {
+            stats.open_size = open.size();
+            stats.closed_size = closed.size();
+            stats.memory_bytes = records.capacity() * sizeof(HdaRecord) +
+                                 frontier.memory_usage() +
+                                 open.memory_usage() +
+                                 closed.memory_usage();
+        }
+
+        //! Share our counters; the first worker also reports the total.
+        void publish()
+        {
+            snapshot();
+            solver.shared_stats.publish(id, stats);
+            if(id == 0)
+            {
+                SearchStatistics total = solver.shared_stats.total(solver.stats);
+                Time f = solver.incumbent.load(std::memory_order_relaxed);
+                if(f != std::numeric_limits<Time>::max())
+                {
+                    total.f_bound = f;
+                }
+                solver.reporter.progress(total);
+            }
+        }
+
+        HDAStarSolver& solver;
+        Problem problem;
+        unsigned id;
+
+        BucketQueue<AstarNode> open;
+        FlatHashMap<State, Time> closed;
+        FrontierPool frontier;
+        std::vector<HdaRecord> records;
+        std::vector<std::vector<HdaMessage>> outgoing;
+        SearchStatistics stats;
+        StatisticsReporter publish_timer;
+    };
+
+    unsigned owner(const State& s) const
+    {
+        return mix_hash(std::hash<State>()(s)) % num_threads;
+    }
+
+    //! Every node on an optimal path has f at least stats.lower_bound, so
+    //! IDA* can start from it, and only needs to look for plans that beat
+    //! found, the incumbent (empty if none). If it finds none, or stops
+    //! first, found is the result.
+    bool finish_with_ida(BuildOrder& found, BuildOrder& result)
+    {
+        IDASolver<Problem> ida((Problem(problem)));
+        ida.set_reporting(reporter.stream(), reporter.period());
+        ida.set_stop_token(stop_token);
+        ida.set_lower_bound(stats.lower_bound);
+        if(!found.empty())
+        {
+            ida.set_upper_bound(found.back().t);
+        }
+        // The table rounds up to a power of two, so this stays within
+        // about half the budget.
+        ida.set_transposition_table(memory_budget / 4 / sizeof(State), TTReplacement::LARGER_SUBTREE);
+
+        bool solved = ida.solve(result);
+
+        const SearchStatistics& ida_stats = ida.statistics();
+        stats.merge(ida_stats);
+        stats.open_size = ida_stats.open_size;
+        stats.closed_size = ida_stats.closed_size;
+        stats.memory_bytes = ida_stats.memory_bytes;
+        stats.set_f_bound(ida_stats.f_bound);
+        stats.stopped = ida_stats.stopped;
+        stats.lower_bound = ida_stats.lower_bound;
+        if(solved || found.empty())
+        {
+            return solved;
+        }
+
+        result = std::move(found);
+        if(!stats.stopped)
+        {
+            // No plan beats the incumbent.
+            stats.lower_bound = result.back().t;
+        }
+        return true;
+    }
+
+    Problem problem;
+    unsigned num_threads;
+    std::size_t memory_budget;
+    const StopToken* stop_token;
+
+    SearchStatistics stats;
+    StatisticsReporter reporter;
+    SharedStatistics shared_stats;
+    double report_interval = 0;
+
+    std::vector<HdaInbox> inboxes = std::vector<HdaInbox>(num_threads);
+
+    //! Active workers plus messages in flight. Zero means the search is over
+    //! and it can never become nonzero again.
+    std::atomic<long> work;
+    std::atomic<Time> incumbent;
+    std::atomic<bool> stopping;
+    std::atomic<bool> over_budget;
+
+    std::mutex goal_mutex;
+    std::uint16_t best_goal_worker;
+    std::uint32_t best_goal_record;
+};
+
+#endif
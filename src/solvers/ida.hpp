@@ -1,8 +1,18 @@
 #ifndef PLANNER_IDA_HPP
 #define PLANNER_IDA_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
 #include "definitions/types.hpp"
 #include "definitions/state.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+#include "solvers/transposition_table.hpp"
+
+//! Default transposition table size of IDASolver, in entries.
+constexpr std::size_t IDA_TABLE_ENTRIES = 1 << 18;
 
 template<typename Problem>
 class IDASolver
@@ -10,37 +20,133 @@ class IDASolver
 public:
     IDASolver(Problem&& problem_ = Problem())
         : problem(problem_)
+        , table(IDA_TABLE_ENTRIES)
+        , min_bound(0)
+        , max_bound(std::numeric_limits<Time>::max())
+        , stop_token(nullptr)
+        , stopping(false)
         , found(false)
     {
     }
 
     bool solve(BuildOrder& result)
     {
+        stats.start();
+        reporter.restart();
+        found = false;
+        stopping = false;
+        depth = 0;
+        table.clear();
+
         Node start = problem.start_node();
-        Time upper_bound = problem.upper_bound();
-        Time lower_bound = problem.heuristic(start);
+        Time upper_bound = std::min(problem.upper_bound(), max_bound);
+        Time lower_bound = std::max(min_bound, timed_heuristic(problem, start, stats));
 
         while(true)
         {
-            lower_bound = ida_search(start, lower_bound);
-            // std::cerr << lower_bound << std::endl;
+            stats.set_f_bound(lower_bound);
+            Time next_bound = ida_search(start, lower_bound);
+            if(stopping)
+            {
+                // No plan costs less than the threshold of this iteration,
+                // or the last one would have found it.
+                stats.stopped = true;
+                stats.lower_bound = lower_bound;
+                snapshot();
+                reporter.finish(stats);
+                return false;
+            }
+            lower_bound = next_bound;
             if(found)
             {
                 result = best;
+                stats.lower_bound = result.back().t;
+                snapshot();
+                reporter.finish(stats);
                 return true;
             }
             else if(lower_bound >= upper_bound)
             {
+                stats.lower_bound = lower_bound;
+                snapshot();
+                reporter.finish(stats);
                 return false;
             }
         }
     }
+
+    //! Send progress reports to os every interval seconds (never if 0) and
+    //! a final report when the search ends. os may be null to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+    }
+
+    //! Remember up to entries States between and within iterations, 0 for
+    //! none. Each entry costs about sizeof(State) bytes.
+    void set_transposition_table(std::size_t entries, TTReplacement policy)
+    {
+        table.resize(entries);
+        table.set_policy(policy);
+    }
+
+    //! Start with a threshold of at least bound, which must not exceed the
+    //! cost of an optimal solution; e.g. one proven by another solver.
+    void set_lower_bound(Time bound)
+    {
+        min_bound = bound;
+    }
+
+    //! Only look for plans that take less than bound, e.g. one found by
+    //! another solver; solve() fails if there is none.
+    void set_upper_bound(Time bound)
+    {
+        max_bound = bound;
+    }
+
+    //! Stop when token asks to (never if null). IDA* has no plan before it
+    //! has an optimal one, so a stopped search only proves a lower bound:
+    //! the threshold it had reached.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
 private:
+    static constexpr Time UNBOUNDED = std::numeric_limits<Time>::max();
+
     Time ida_search(const Node& n, Time limit)
     {
-        Time f = n.t + problem.heuristic(n);
+        ++stats.generated;
+
+        // A State searched before, after the same action, has a cost-to-go
+        // of at least what it was found to be then. That bound is usually
+        // better than the heuristic, and if it already exceeds the limit the
+        // subtree need not be searched again.
+        Time learned_h = 0;
+        if(const TTEntry* e = table.find(n.state, n.action.id))
+        {
+            if(e->bound == UNBOUNDED)
+            {
+                ++stats.duplicates;
+                return UNBOUNDED;
+            }
+            learned_h = e->bound - e->g;
+            if(n.t + learned_h > limit)
+            {
+                ++stats.duplicates;
+                return n.t + learned_h;
+            }
+        }
+
+        Time f = n.t + std::max(learned_h, timed_heuristic(problem, n, stats));
         if(f > limit)
         {
+            table.store(n.state, n.action.id, TTEntry {n.t, f, 0});
             return f;
         }
         else if(problem.is_goal(n))
@@ -51,9 +157,23 @@ private:
         }
         else
         {
-            Time min_f = std::numeric_limits<Time>::max();
+            ++stats.expanded;
+            if(reporter.due())
+            {
+                snapshot();
+                reporter.progress(stats);
+            }
+            if(should_stop(stop_token, stats.expanded))
+            {
+                stopping = true;
+                return UNBOUNDED;
+            }
+
+            std::size_t expanded_before = stats.expanded;
+            Time min_f = UNBOUNDED;
+            ++depth;
             problem.visit_neighbors(n, [this, limit, &min_f](const Node& n) mutable {
-                if(found)
+                if(found || stopping)
                     return;
 
                 Time new_f = ida_search(n, limit);
@@ -62,11 +182,36 @@ private:
                     min_f = new_f;
                 }
             });
+            --depth;
+
+            // What a stopped search learned about this State is incomplete.
+            if(!found && !stopping)
+            {
+                std::size_t work = stats.expanded - expanded_before;
+                table.store(n.state, n.action.id, TTEntry {n.t, min_f, std::uint32_t(std::min<std::size_t>(work, std::numeric_limits<std::uint32_t>::max()))});
+            }
             return min_f;
         }
     }
 
+    void snapshot()
+    {
+        // The open list is the recursion stack.
+        stats.open_size = depth;
+        stats.closed_size = table.size();
+        stats.memory_bytes = depth * sizeof(Node) + best.capacity() * sizeof(Node) + table.memory_usage();
+    }
+
     Problem problem;
+    TranspositionTable table;
+    Time min_bound;
+    Time max_bound;
+    const StopToken* stop_token;
+    bool stopping;
+
+    SearchStatistics stats;
+    StatisticsReporter reporter;
+    std::size_t depth;
 
     bool found;
     BuildOrder best;
@@ -0,0 +1,374 @@
+#ifndef PLANNER_PARALLEL_DFBB_HPP
+#define PLANNER_PARALLEL_DFBB_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "solvers/statistics.hpp"
+#include "solvers/stop_token.hpp"
+
+//! A subtree to search: its root and the actions leading to it.
+struct DFBBTask
+{
+    Node node;
+    std::vector<ActionId> path;
+};
+
+//! Subtrees are only handed out while the owner has fewer than this many
+//! queued, so that splitting stays rare once everybody is busy.
+constexpr std::size_t DFBB_MAX_QUEUED_TASKS = 4;
+
+//! Expansions between the times a worker shares its counters even without
+//! progress reports, so that the f layers count the nodes of all workers
+//! to within this many each.
+constexpr std::size_t DFBB_SHARE_PERIOD = 1024;
+
+//! Depth-first branch and bound on a work-stealing thread pool.
+//!
+//! Each worker searches depth-first like DFBBSolver. While some worker is
+//! idle, the remaining siblings of the node being expanded are pushed onto
+//! the worker's deque instead of being recursed into; idle workers steal
+//! the oldest, and so largest, subtrees from the front. The incumbent
+//! bound is a single atomic, so every improvement prunes all workers at
+//! once.
+template<typename Problem>
+class ParallelDFBBSolver
+{
+public:
+    ParallelDFBBSolver(Problem&& problem_ = Problem(), unsigned num_threads_ = std::thread::hardware_concurrency())
+        : problem(problem_)
+        , num_threads(num_threads_ > 0 ? num_threads_ : 1)
+        , stop_token(nullptr)
+    {
+    }
+
+    bool solve(BuildOrder& result)
+    {
+        stats.start();
+        reporter.restart();
+        shared_stats.reset(num_threads);
+
+        start = problem.start_node();
+        upper_bound = problem.upper_bound();
+        // Without a bound the depth-first search would never come back.
+        if(upper_bound == NEVER)
+            throw std::runtime_error("parallel-dfbb: no simple plan bounds the search from this start; try astar");
+        stats.set_f_bound(upper_bound);
+        found = false;
+        pending = 1;
+        idle = 0;
+        stopping = false;
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        for(unsigned i = 0; i < num_threads; ++i)
+        {
+            workers.emplace_back(new Worker(*this, i));
+        }
+        workers[0]->queue.tasks.push_back(DFBBTask {start, std::vector<ActionId>()});
+
+        queues.clear();
+        for(const auto& w : workers)
+        {
+            queues.push_back(&w->queue);
+        }
+
+        std::vector<std::thread> threads;
+        for(unsigned i = 1; i < num_threads; ++i)
+        {
+            threads.emplace_back(&Worker::run, workers[i].get());
+        }
+        workers[0]->run();
+        for(std::thread& t : threads)
+        {
+            t.join();
+        }
+
+        for(const auto& w : workers)
+        {
+            w->snapshot();
+            stats.merge(w->stats);
+        }
+        if(stopping)
+        {
+            // Nothing is known about the unexplored subtrees beyond the
+            // heuristic.
+            stats.stopped = true;
+            stats.lower_bound = std::min<Time>(upper_bound, start.t + timed_heuristic(problem, start, stats));
+        }
+        else
+        {
+            stats.lower_bound = upper_bound;
+        }
+        reporter.finish(stats);
+
+        if(found)
+        {
+            result = best;
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    //! Send progress reports to os every interval seconds (never if 0), every
+    //! improved plan, and a final report when the search ends. os may be null
+    //! to disable them.
+    void set_reporting(std::ostream* os, double interval)
+    {
+        reporter.configure(os, interval);
+        report_interval = interval;
+    }
+
+    //! Stop when token asks to (never if null), with the best plan found
+    //! so far. Any worker that notices stops all of them.
+    void set_stop_token(const StopToken* token)
+    {
+        stop_token = token;
+    }
+
+    const SearchStatistics& statistics() const
+    {
+        return stats;
+    }
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<DFBBTask> tasks;
+    };
+
+    struct Worker
+    {
+        Worker(ParallelDFBBSolver& solver_, unsigned id_)
+            : solver(solver_)
+            , problem(solver_.problem)
+            , id(id_)
+            , publish_timer(nullptr, solver_.report_interval)
+        {
+        }
+
+        void run()
+        {
+            DFBBTask task;
+            bool idle = false;
+            while(solver.pending.load(std::memory_order_acquire) > 0 &&
+                  !solver.stopping.load(std::memory_order_relaxed))
+            {
+                if(pop(task) || steal(task))
+                {
+                    if(idle)
+                    {
+                        solver.idle.fetch_sub(1, std::memory_order_relaxed);
+                        idle = false;
+                    }
+                    path.swap(task.path);
+                    dfbb(task.node);
+                    solver.pending.fetch_sub(1, std::memory_order_acq_rel);
+                }
+                else
+                {
+                    if(!idle)
+                    {
+                        solver.idle.fetch_add(1, std::memory_order_relaxed);
+                        idle = true;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            if(idle)
+            {
+                solver.idle.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        bool pop(DFBBTask& task)
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(queue.tasks.empty())
+                return false;
+
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(DFBBTask& task)
+        {
+            for(unsigned i = 1; i <= solver.queues.size(); ++i)
+            {
+                TaskQueue& victim = *solver.queues[(id + i) % solver.queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if(!victim.tasks.empty())
+                {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool should_split()
+        {
+            if(solver.idle.load(std::memory_order_relaxed) == 0)
+                return false;
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            return queue.tasks.size() < DFBB_MAX_QUEUED_TASKS;
+        }
+
+        void spawn(const Node& n)
+        {
+            DFBBTask task {n, path};
+            task.node.predecessor = nullptr;
+            task.path.push_back(n.action.id);
+
+            solver.pending.fetch_add(1, std::memory_order_acq_rel);
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        void dfbb(const Node& n)
+        {
+            if(problem.is_goal(n))
+            {
+                // The new f layer counts what we expanded so far.
+                solver.shared_stats.publish(id, stats);
+                solver.improve(n, path);
+            }
+            else
+            {
+                ++stats.expanded;
+                if(publish_timer.due())
+                {
+                    publish();
+                }
+                else if(stats.expanded % DFBB_SHARE_PERIOD == 0)
+                {
+                    solver.shared_stats.publish(id, stats);
+                }
+                if(should_stop(solver.stop_token, stats.expanded))
+                {
+                    solver.stopping.store(true, std::memory_order_relaxed);
+                }
+
+                bool first = true;
+                problem.visit_neighbors(n, [this, &first](const Node& succ) {
+                    if(solver.stopping.load(std::memory_order_relaxed))
+                        return;
+
+                    ++stats.generated;
+                    if(succ.t + timed_heuristic(problem, succ, stats) >= solver.upper_bound.load(std::memory_order_relaxed))
+                        return;
+
+                    // Always keep the first child for ourselves.
+                    if(!first && should_split())
+                    {
+                        spawn(succ);
+                        return;
+                    }
+                    first = false;
+
+                    path.push_back(succ.action.id);
+                    dfbb(succ);
+                    path.pop_back();
+                });
+            }
+        }
+
+        void snapshot()
+        {
+            std::size_t queued;
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queued = queue.tasks.size();
+            }
+            // Queued subtrees plus the recursion stack.
+            stats.open_size = queued + path.size();
+            stats.memory_bytes = queued * sizeof(DFBBTask) + path.size() * sizeof(Node);
+        }
+
+        //! Share our counters; the first worker also reports the total.
+        void publish()
+        {
+            snapshot();
+            solver.shared_stats.publish(id, stats);
+            if(id == 0)
+            {
+                std::lock_guard<std::mutex> lock(solver.best_mutex);
+                SearchStatistics total = solver.shared_stats.total(solver.stats);
+                solver.reporter.progress(total);
+            }
+        }
+
+        ParallelDFBBSolver& solver;
+        Problem problem;
+        unsigned id;
+
+        TaskQueue queue;
+        std::vector<ActionId> path;
+
+        SearchStatistics stats;
+        StatisticsReporter publish_timer;
+    };
+
+    void improve(const Node& n, const std::vector<ActionId>& path)
+    {
+        std::lock_guard<std::mutex> lock(best_mutex);
+        if(n.t < upper_bound.load(std::memory_order_relaxed))
+        {
+            upper_bound.store(n.t, std::memory_order_relaxed);
+            // The workers count the nodes they expand.
+            stats.set_f_bound(n.t, shared_stats.total(stats).expanded);
+            found = true;
+            best = replay_solution(start, path);
+            assert(best.back().t == n.t);
+
+            if(std::ostream* os = reporter.stream())
+            {
+                for(auto iter = best.rbegin(); iter + 1 != best.rend(); ++iter)
+                {
+                    *os << *iter << '\n';
+                }
+                *os << std::endl;
+            }
+        }
+    }
+
+    Problem problem;
+    unsigned num_threads;
+    const StopToken* stop_token;
+
+    //! Written by improve() under best_mutex, and read after the search.
+    SearchStatistics stats;
+    StatisticsReporter reporter;
+    SharedStatistics shared_stats;
+    double report_interval = 0;
+
+    Node start;
+    std::vector<TaskQueue*> queues;
+
+    //! Tasks queued or running. The search is over once this reaches zero.
+    std::atomic<long> pending;
+    std::atomic<unsigned> idle;
+    std::atomic<Time> upper_bound;
+    std::atomic<bool> stopping;
+
+    std::mutex best_mutex;
+    bool found;
+    BuildOrder best;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef PLANNER_REPLANNER_HPP
+#define PLANNER_REPLANNER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/actions.hpp"
+#include "problems/buildorder.hpp"
+#include "problems/search_memory.hpp"
+#include "problems/specification.hpp"
+#include "solvers/batch.hpp"
+#include "solvers/dispatch.hpp"
+#include "solvers/stop_token.hpp"
+
+//! What one search proved, kept until its SearchMemory can learn it, as it
+//! must not change while other searches read it.
+struct SearchLessons
+{
+    typedef std::pair<State, Time> Bound;
+
+    //! Most bounds kept. Beyond that the highest ones win, as they prune
+    //! the most; the SearchMemory has no room for more anyway.
+    std::size_t max_bounds = SEARCH_MEMORY_STATES;
+    //! A heap with the lowest bound first.
+    std::vector<Bound> bounds;
+    std::vector<BuildOrder> plans;
+
+    void learn_bound(const State& s, Time ticks)
+    {
+        if(bounds.size() < max_bounds)
+        {
+            bounds.emplace_back(s, ticks);
+            std::push_heap(bounds.begin(), bounds.end(), higher);
+        }
+        else if(!bounds.empty() && ticks > bounds.front().second)
+        {
+            std::pop_heap(bounds.begin(), bounds.end(), higher);
+            bounds.back() = Bound(s, ticks);
+            std::push_heap(bounds.begin(), bounds.end(), higher);
+        }
+    }
+
+    //! Add what other proved, within max_bounds.
+    void merge(const SearchLessons& other)
+    {
+        for(const Bound& b : other.bounds)
+        {
+            learn_bound(b.first, b.second);
+        }
+        plans.insert(plans.end(), other.plans.begin(), other.plans.end());
+    }
+
+    void teach(SearchMemory& memory) const
+    {
+        for(const auto& b : bounds)
+        {
+            memory.learn_bound(b.first, b.second);
+        }
+        for(const BuildOrder& plan : plans)
+        {
+            memory.learn_plan(plan);
+        }
+    }
+
+private:
+    static bool higher(const Bound& a, const Bound& b)
+    {
+        return a.second > b.second;
+    }
+};
+
+//! Solve the problem of spec like solve_specification(), reusing what
+//! memory holds about earlier problems with the same goal and constants:
+//! if a plan it knows passes through the start, the rest of that plan is
+//! the answer, without a search; otherwise its bounds raise the heuristic.
+//! What the search proves is added to lessons, which must start empty, for
+//! memory to learn once no search reads it: no more bounds than memory has
+//! room for, and out of the memory budget of the search. Nothing is added
+//! if the search ran into the capacity of State.
+SolveResult replan_specification(const ProblemSpecification& spec, const SolverOptions& options, std::shared_ptr<GatherCache> cache, const SearchMemory& memory, double time_limit, const StopToken* stop, SearchLessons& lessons)
+{
+    SearchClock::time_point started = SearchClock::now();
+    Node observed;
+    observed.t = spec.start_time;
+    observed.state = spec.start;
+    canonicalize(observed.state);
+
+    SolveResult r;
+    if(memory.continuation(observed, r.plan))
+    {
+        r.solved = true;
+        r.reused = true;
+        r.stats.lower_bound = r.plan.back().t;
+        r.seconds = std::chrono::duration<double>(SearchClock::now() - started).count();
+        return r;
+    }
+
+    SolverOptions learning = options;
+    lessons.max_bounds = memory.states_left();
+    if(options.memory_budget > 0)
+    {
+        // The bounds are collected while the search still holds all of its
+        // tables, and their vector may grow to twice its size.
+        lessons.max_bounds = std::min(lessons.max_bounds, options.memory_budget / 8 / sizeof(SearchLessons::Bound));
+        learning.memory_budget -= 2 * lessons.max_bounds * sizeof(SearchLessons::Bound);
+    }
+    if(lessons.max_bounds > 0)
+    {
+        learning.on_bound = [&lessons](const State& s, Time ticks) {
+            lessons.learn_bound(s, ticks);
+        };
+    }
+    r = solve_specification(spec, learning, std::move(cache), time_limit, stop, &memory);
+    if(r.stats.capacity_cuts > 0)
+    {
+        // The plan is only optimal among those with at most MAX_RPS RPs,
+        // so neither it nor the bounds that derive from it hold.
+        lessons.bounds.clear();
+        return r;
+    }
+    if(r.solved && !r.stats.stopped)
+    {
+        lessons.plans.push_back(r.plan);
+    }
+    return r;
+}
+
+//! Plans toward one goal, under the game constants in effect, from
+//! whatever State the game is in each time it is asked, reusing what it
+//! learned from the plans and searches before. Replanning from a State
+//! further along an earlier plan takes no search at all. Replanning from
+//! one near it searches with the bounds A* proved before and the repaired
+//! rest of the plan as an upper bound, which A* gains little from; see
+//! SearchMemory.
+class Replanner
+{
+public:
+    explicit Replanner(unsigned goal_zps_ = NUM_ZPS, const SolverOptions& options_ = SolverOptions())
+        : goal_zps(goal_zps_)
+        , options(options_)
+        , cache(std::make_shared<GatherCache>())
+    {
+    }
+
+    //! Plan from s, observed at tick t; see replan_specification(). The
+    //! constants must not change between calls.
+    SolveResult replan(const State& s, Time t, double time_limit = 0, const StopToken* stop = nullptr)
+    {
+        ProblemSpecification spec;
+        spec.constants = game;
+        spec.start = s;
+        spec.start_time = t;
+        spec.goal_zps = goal_zps;
+
+        SearchLessons lessons;
+        SolveResult r = replan_specification(spec, options, cache, memory, time_limit, stop, lessons);
+        lessons.teach(memory);
+        return r;
+    }
+
+    const SearchMemory& search_memory() const
+    {
+        return memory;
+    }
+
+private:
+    unsigned goal_zps;
+    SolverOptions options;
+    std::shared_ptr<GatherCache> cache;
+    SearchMemory memory;
+};
+
+#endif
@@ -0,0 +1,279 @@
+#ifndef PLANNER_STATISTICS_HPP
+#define PLANNER_STATISTICS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+
+typedef std::chrono::steady_clock SearchClock;
+
+//! Point at which the search bound first reached f.
+struct FLayer
+{
+    Time f;
+    std::size_t expanded;
+    double seconds;
+};
+
+//! Progress counters every solver fills in.
+struct SearchStatistics
+{
+    std::size_t expanded = 0;
+    std::size_t generated = 0;
+    //! Nodes dropped because their State was already known at least as cheaply.
+    std::size_t duplicates = 0;
+    //! Nodes dropped because a node seen no later was at least as good.
+    std::size_t dominated = 0;
+    std::size_t heuristic_calls = 0;
+    //! Estimated from one call in HEURISTIC_TIMING_PERIOD.
+    double heuristic_seconds = 0;
+
+    std::size_t open_size = 0;
+    std::size_t closed_size = 0;
+    //! Approximate bytes held by the solver's data structures.
+    std::size_t memory_bytes = 0;
+
+    //! Current f bound: the highest f expanded so far by A*, the IDA*
+    //! threshold or the DFBB incumbent. f_layers records each time it
+    //! changed.
+    Time f_bound = std::numeric_limits<Time>::max();
+    std::vector<FLayer> f_layers;
+
+    //! Whether the search was stopped before it finished; see StopToken.
+    bool stopped = false;
+    //! Lower bound on the cost of an optimal plan that the search has
+    //! proven. Once a plan is proven optimal, this is its cost.
+    Time lower_bound = 0;
+    //! Nodes that could not build an RP only for lack of room in State; if
+    //! not 0, plans and bounds only hold for plans with at most MAX_RPS
+    //! RPs. Filled in by run_solver().
+    std::size_t capacity_cuts = 0;
+
+    SearchClock::time_point started = SearchClock::now();
+
+    void start()
+    {
+        *this = SearchStatistics();
+    }
+
+    double elapsed_seconds() const
+    {
+        return std::chrono::duration<double>(SearchClock::now() - started).count();
+    }
+
+    double nodes_per_second() const
+    {
+        double s = elapsed_seconds();
+        return s > 0 ? expanded / s : 0;
+    }
+
+    void set_f_bound(const Time f)
+    {
+        set_f_bound(f, expanded);
+    }
+
+    //! Like set_f_bound(f), for searches whose workers count the nodes
+    //! they expand, expanded_so_far of them in all.
+    void set_f_bound(const Time f, std::size_t expanded_so_far)
+    {
+        if(f != f_bound)
+        {
+            f_bound = f;
+            f_layers.push_back(FLayer {f, expanded_so_far, elapsed_seconds()});
+        }
+    }
+
+    //! Add the counters of another worker of the same search.
+    void merge(const SearchStatistics& other)
+    {
+        expanded += other.expanded;
+        generated += other.generated;
+        duplicates += other.duplicates;
+        dominated += other.dominated;
+        heuristic_calls += other.heuristic_calls;
+        heuristic_seconds += other.heuristic_seconds;
+        open_size += other.open_size;
+        closed_size += other.closed_size;
+        memory_bytes += other.memory_bytes;
+    }
+};
+
+//! Write s as a single line of JSON. The f layers are only included if
+//! asked for, as there can be many of them.
+inline void write_json(std::ostream& os, const SearchStatistics& s, const char* event, const bool with_layers)
+{
+    os << "{\"event\": \"" << event << "\""
+       << ", \"seconds\": " << s.elapsed_seconds()
+       << ", \"expanded\": " << s.expanded
+       << ", \"generated\": " << s.generated
+       << ", \"duplicates\": " << s.duplicates
+       << ", \"dominated\": " << s.dominated
+       << ", \"heuristic_calls\": " << s.heuristic_calls
+       << ", \"heuristic_seconds\": " << s.heuristic_seconds
+       << ", \"open\": " << s.open_size
+       << ", \"closed\": " << s.closed_size
+       << ", \"memory_bytes\": " << s.memory_bytes
+       << ", \"nodes_per_second\": " << s.nodes_per_second()
+       << ", \"stopped\": " << (s.stopped ? "true" : "false")
+       << ", \"lower_bound\": " << s.lower_bound;
+    if(s.capacity_cuts > 0)
+    {
+        os << ", \"capacity_cuts\": " << s.capacity_cuts;
+    }
+    if(s.f_bound != std::numeric_limits<Time>::max())
+    {
+        os << ", \"f_bound\": " << s.f_bound;
+    }
+    if(with_layers)
+    {
+        os << ", \"f_layers\": [";
+        for(std::size_t i = 0; i < s.f_layers.size(); ++i)
+        {
+            const FLayer& l = s.f_layers[i];
+            os << (i ? ", " : "") << "{\"f\": " << l.f << ", \"expanded\": " << l.expanded << ", \"seconds\": " << l.seconds << "}";
+        }
+        os << "]";
+    }
+    os << "}" << std::endl;
+}
+
+//! Decides when to emit statistics. Progress reports go out every
+//! interval seconds (never if the interval is 0), the final report when
+//! the search ends.
+class StatisticsReporter
+{
+public:
+    StatisticsReporter(std::ostream* os_ = &std::cerr, double interval_ = 0)
+        : os(os_)
+        , interval(interval_)
+        , calls(0)
+        , last(SearchClock::now())
+    {
+    }
+
+    void configure(std::ostream* os_, double interval_)
+    {
+        os = os_;
+        interval = interval_;
+    }
+
+    void restart()
+    {
+        calls = 0;
+        last = SearchClock::now();
+    }
+
+    //! Cheap enough to call on every expansion; the clock is only read
+    //! every so often.
+    bool due()
+    {
+        if(interval <= 0 || ++calls % CLOCK_CHECK_PERIOD != 0)
+            return false;
+
+        SearchClock::time_point now = SearchClock::now();
+        if(std::chrono::duration<double>(now - last).count() < interval)
+            return false;
+
+        last = now;
+        return true;
+    }
+
+    void progress(const SearchStatistics& s)
+    {
+        if(os != nullptr)
+            write_json(*os, s, "progress", false);
+    }
+
+    void finish(const SearchStatistics& s)
+    {
+        if(os != nullptr)
+            write_json(*os, s, "finished", true);
+    }
+
+    //! Report that the search stops here and another one takes over.
+    void handover(const SearchStatistics& s)
+    {
+        if(os != nullptr)
+            write_json(*os, s, "handover", false);
+    }
+
+    std::ostream* stream() const { return os; }
+    double period() const { return interval; }
+
+private:
+    static constexpr unsigned CLOCK_CHECK_PERIOD = 256;
+
+    std::ostream* os;
+    double interval;
+    unsigned calls;
+    SearchClock::time_point last;
+};
+
+//! The heuristic is timed on one call in this many, so that reading the
+//! clock stays out of the cost of a node.
+constexpr std::size_t HEURISTIC_TIMING_PERIOD = 64;
+
+//! Call problem.heuristic(n), counting it and estimating its time from a
+//! sample of the calls.
+template<typename Problem>
+Time timed_heuristic(Problem& problem, const Node& n, SearchStatistics& stats)
+{
+    if(stats.heuristic_calls++ % HEURISTIC_TIMING_PERIOD != 0)
+        return problem.heuristic(n);
+
+    SearchClock::time_point start = SearchClock::now();
+    Time h = problem.heuristic(n);
+    stats.heuristic_seconds += HEURISTIC_TIMING_PERIOD * std::chrono::duration<double>(SearchClock::now() - start).count();
+    return h;
+}
+
+//! Per-worker statistics of a multi-threaded solver. Each worker publishes
+//! a snapshot now and then, and one of them reports the sum.
+class SharedStatistics
+{
+public:
+    explicit SharedStatistics(std::size_t workers = 0)
+        : snapshots(workers)
+    {
+    }
+
+    void reset(std::size_t workers)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshots.assign(workers, SearchStatistics());
+    }
+
+    void publish(std::size_t worker, const SearchStatistics& s)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshots[worker] = s;
+    }
+
+    //! Sum of the latest snapshots. Timing and f bound come from base.
+    SearchStatistics total(const SearchStatistics& base)
+    {
+        SearchStatistics sum = base;
+        sum.expanded = sum.generated = sum.duplicates = sum.dominated = sum.heuristic_calls = 0;
+        sum.heuristic_seconds = 0;
+        sum.open_size = sum.closed_size = sum.memory_bytes = 0;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for(const SearchStatistics& s : snapshots)
+        {
+            sum.merge(s);
+        }
+        return sum;
+    }
+
+private:
+    std::mutex mutex;
+    std::vector<SearchStatistics> snapshots;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef PLANNER_STOP_TOKEN_HPP
+#define PLANNER_STOP_TOKEN_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+#include "solvers/statistics.hpp"
+
+//! Expansions between checks of a StopToken.
+constexpr std::size_t STOP_CHECK_PERIOD = 256;
+
+//! Asks a search to stop early: once its deadline has passed, or once
+//! cancel() has been called from any thread. A stopped solver returns the
+//! best plan it has found, if any, and records in its statistics that it
+//! stopped and what lower bound on the optimal cost it had proven.
+//!
+//! Set the deadline before the search starts; cancel() may be called at any
+//! time. One token can stop several searches, directly or as the parent of
+//! their own tokens.
+class StopToken
+{
+public:
+    StopToken()
+        : cancelled(false)
+        , has_deadline(false)
+        , parent(nullptr)
+    {
+    }
+
+    //! Stop seconds from now.
+    explicit StopToken(double seconds)
+        : StopToken()
+    {
+        set_deadline(seconds);
+    }
+
+    //! Stop seconds from now (never if 0), or as soon as parent does.
+    StopToken(double seconds, const StopToken* parent_)
+        : StopToken(seconds)
+    {
+        parent = parent_;
+    }
+
+    StopToken(const StopToken&) = delete;
+    StopToken& operator=(const StopToken&) = delete;
+
+    //! Stop seconds from now, or never if seconds is 0.
+    void set_deadline(double seconds)
+    {
+        has_deadline = seconds > 0;
+        deadline = SearchClock::now() + std::chrono::duration_cast<SearchClock::duration>(std::chrono::duration<double>(seconds));
+    }
+
+    void cancel()
+    {
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+
+    bool stop_requested() const
+    {
+        return cancelled.load(std::memory_order_relaxed) ||
+               (has_deadline && SearchClock::now() >= deadline) ||
+               (parent != nullptr && parent->stop_requested());
+    }
+
+private:
+    std::atomic<bool> cancelled;
+    bool has_deadline;
+    SearchClock::time_point deadline;
+    const StopToken* parent;
+};
+
+//! Whether a search that has made expanded expansions should stop. token
+//! may be null for a search that runs to the end. The clock is only read
+//! every STOP_CHECK_PERIOD expansions.
+inline bool should_stop(const StopToken* token, std::size_t expanded)
+{
+    return token != nullptr && expanded % STOP_CHECK_PERIOD == 0 && token->stop_requested();
+}
+
+#endif
@@ -0,0 +1,146 @@
+#ifndef PLANNER_TRANSPOSITION_TABLE_HPP
+#define PLANNER_TRANSPOSITION_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "definitions/types.hpp"
+#include "definitions/state.hpp"
+#include "definitions/hash.hpp"
+
+//! Which of two States mapping to the same transposition table slot to keep.
+enum class TTReplacement
+{
+    //! The one stored last.
+    ALWAYS,
+    //! The one whose search took more expansions, which is the more
+    //! expensive one to redo.
+    LARGER_SUBTREE
+};
+
+//! What a depth-first search learned about a State: searched at cost g, no
+//! solution through it costs less than bound.
+struct TTEntry
+{
+    Time g;
+    Time bound;
+    std::uint32_t work;
+};
+
+//! Fixed-size table of TTEntries for one thread. Direct-mapped, like
+//! HeuristicCache: every State has one slot, and the replacement policy
+//! decides what happens when another State already holds it.
+//!
+//! Entries are keyed by the State and the action that led to it, as
+//! BuildOrderProblem::visit_neighbors() offers different successors after
+//! different actions: a bound learned in the subtree after one action need
+//! not hold after another. The action shares the State's slot.
+class TranspositionTable
+{
+public:
+    //! capacity is rounded up to a power of two; 0 disables the table.
+    explicit TranspositionTable(std::size_t capacity = 0, TTReplacement policy_ = TTReplacement::LARGER_SUBTREE)
+        : policy(policy_)
+        , hits(0)
+        , misses(0)
+        , occupied(0)
+    {
+        resize(capacity);
+    }
+
+    void resize(std::size_t capacity)
+    {
+        std::size_t size = capacity > 0 ? 1 : 0;
+        while(size < capacity)
+        {
+            size *= 2;
+        }
+        std::vector<Slot>(size).swap(slots);
+        hits = misses = 0;
+        occupied = 0;
+    }
+
+    void set_policy(TTReplacement policy_) { policy = policy_; }
+
+    bool enabled() const { return !slots.empty(); }
+
+    //! Return the entry for s reached by action last, or null if there is
+    //! none.
+    const TTEntry* find(const State& s, ActionId last)
+    {
+        if(!enabled())
+            return nullptr;
+
+        const Slot& slot = slot_for(s);
+        if(slot.valid && slot.last == last && slot.state == s)
+        {
+            ++hits;
+            return &slot.entry;
+        }
+        ++misses;
+        return nullptr;
+    }
+
+    void store(const State& s, ActionId last, const TTEntry& e)
+    {
+        if(!enabled())
+            return;
+
+        Slot& slot = slot_for(s);
+        if(slot.valid && !(slot.last == last && slot.state == s) &&
+           policy == TTReplacement::LARGER_SUBTREE && slot.entry.work > e.work)
+        {
+            return;
+        }
+        if(!slot.valid)
+        {
+            ++occupied;
+        }
+        slot.state = s;
+        slot.last = last;
+        slot.entry = e;
+        slot.valid = true;
+    }
+
+    void clear()
+    {
+        for(Slot& slot : slots)
+        {
+            slot.valid = false;
+        }
+        hits = misses = 0;
+        occupied = 0;
+    }
+
+    std::size_t hit_count() const { return hits; }
+    std::size_t miss_count() const { return misses; }
+
+    //! Slots holding an entry.
+    std::size_t size() const { return occupied; }
+    std::size_t capacity() const { return slots.size(); }
+    std::size_t memory_usage() const { return slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot
+    {
+        State state;
+        ActionId last;
+        TTEntry entry;
+        bool valid = false;
+    };
+
+    Slot& slot_for(const State& s)
+    {
+        return slots[mix_hash(std::hash<State>()(s)) & (slots.size() - 1)];
+    }
+
+    TTReplacement policy;
+    std::vector<Slot> slots;
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t occupied;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Run external-astar with small buffers and many partitions, so that the
+# search files are written and merged often and some partitions stay empty.
+# Usage: external_test.sh PATH_TO_BARYON
+
+baryon=$1
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+fail()
+{
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# With partitions partitions and a buffer of MB, the optimal plan for one
+# ZP must be found and the search files removed.
+expect()
+{
+    "$baryon" --solver external-astar --zps 1 --partitions "$1" --buffer "$2" \
+        --scratch "$dir/scratch" --report-interval 0 > "$dir/plan.out" 2> "$dir/plan.err" \
+        || fail "$1 partitions: baryon exited with $?: $(cat "$dir/plan.err")"
+    tail -n 1 "$dir/plan.out" | grep -q '^\[1m 43s 12t\]' || fail "$1 partitions: expected a plan of 1m 43s 12t"
+    [ -z "$(ls -A "$dir/scratch")" ] || fail "$1 partitions: search files were left behind"
+}
+
+expect 64 0.01
+expect 1 0.01
+
+echo "external test passed"
@@ -0,0 +1,69 @@
+#!/bin/sh
+# Exercise baryon --serve on stdin and on a Unix domain socket.
+# Usage: service_test.sh PATH_TO_BARYON
+
+baryon=$1
+dir=$(mktemp -d) || exit 1
+server=
+trap '[ -n "$server" ] && kill "$server" 2>/dev/null; rm -rf "$dir"' EXIT
+
+fail()
+{
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# The answer line of instance name in file, which must have exactly one.
+answer()
+{
+    [ "$(grep -c "\"instance\": \"$2\"" "$1")" = 1 ] || fail "$1: expected one answer for $2"
+    grep "\"instance\": \"$2\"" "$1"
+}
+
+expect()
+{
+    answer "$1" "$2" | grep -q "$3" || fail "$1: answer for $2 lacks $3"
+}
+
+# On stdin: a good request, a bad key, and a change of constants and back,
+# each answered on a line of its own.
+printf '%s\n' \
+    '[good]' 'goal.zps = 1' '' \
+    '[bad]' 'nokey = 1' '' \
+    '[faster]' 'goal.zps = 1' 'zp_build_time = 500' '' \
+    '[again]' 'goal.zps = 1' \
+    | "$baryon" --serve --jobs 2 > "$dir/stdin.out" || fail "--serve on stdin exited with $?"
+
+[ "$(wc -l < "$dir/stdin.out")" -eq 4 ] || fail "expected 4 answer lines on stdout"
+expect "$dir/stdin.out" good '"makespan": 1866'
+expect "$dir/stdin.out" bad "\"error\": \"line 1: unknown key 'nokey'\""
+expect "$dir/stdin.out" faster '"makespan": 1812'
+expect "$dir/stdin.out" again '"makespan": 1866'
+
+# On a socket: two clients at once, with different constants.
+socket=$dir/baryon.sock
+"$baryon" --serve --socket "$socket" --jobs 2 &
+server=$!
+tries=0
+while [ ! -S "$socket" ]; do
+    tries=$((tries + 1))
+    [ "$tries" -le 100 ] || fail "the server did not create $socket"
+    sleep 0.1
+done
+
+"$baryon" --client "$socket" --zps 1 > "$dir/client1.out" &
+client1=$!
+"$baryon" --client "$socket" --zps 1 --set zp_build_time=500 > "$dir/client2.out" &
+client2=$!
+wait "$client1" || fail "the first client exited with $?"
+wait "$client2" || fail "the second client exited with $?"
+expect "$dir/client1.out" request '"makespan": 1866'
+expect "$dir/client2.out" request '"makespan": 1812'
+
+# SIGTERM stops the server cleanly and removes the socket file.
+kill -TERM "$server"
+wait "$server" || fail "the server exited with $? on SIGTERM"
+server=
+[ ! -e "$socket" ] || fail "$socket was left behind"
+
+echo "service test passed"
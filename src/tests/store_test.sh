@@ -0,0 +1,55 @@
+#!/bin/sh
+# Exercise baryon --store across processes, and its repair of a torn record.
+# Usage: store_test.sh PATH_TO_BARYON
+
+baryon=$1
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+store=$dir/plans
+
+fail()
+{
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# Solve with the store and the given options; the plan must end at time,
+# and come from the store or not as from_store says.
+expect()
+{
+    from_store=$1
+    time=$2
+    shift 2
+    "$baryon" --store "$store" --report-interval 0 "$@" > "$dir/plan.out" 2> "$dir/plan.err" \
+        || fail "$*: baryon exited with $?: $(cat "$dir/plan.err")"
+    tail -n 1 "$dir/plan.out" | grep -q "^\[$time\]" || fail "$*: expected a plan of $time"
+    if [ "$from_store" = yes ]; then
+        grep -q "^Optimal plan from $store\.$" "$dir/plan.err" || fail "$*: the plan was not taken from the store"
+    else
+        ! grep -q "^Optimal plan from" "$dir/plan.err" || fail "$*: the plan was taken from the store"
+    fi
+}
+
+size()
+{
+    wc -c < "$store" | tr -d ' '
+}
+
+# One process records the plan, the next finds it.
+expect no '1m 43s 12t' --zps 1
+expect yes '1m 43s 12t' --zps 1
+recorded=$(size)
+
+# A crash in the middle of an append leaves part of a record: here the
+# start of the first one, after the 16 byte file header.
+tail -c +17 "$store" | head -c 20 >> "$store"
+[ "$(size)" -eq $((recorded + 20)) ] || fail "could not append a torn record"
+expect yes '1m 43s 12t' --zps 1
+[ "$(size)" -eq "$recorded" ] || fail "the torn record was not cut off: $(size) bytes, expected $recorded"
+
+# Records appended after the repair are found.
+expect no '1m 40s 12t' --zps 1 --set zp_build_time=500
+expect yes '1m 40s 12t' --zps 1 --set zp_build_time=500
+expect yes '1m 43s 12t' --zps 1
+
+echo "store test passed"